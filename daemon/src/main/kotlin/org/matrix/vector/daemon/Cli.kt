@@ -199,7 +199,8 @@ object OutputFormatter {
             ScopeCommand::class,
             ConfigCommand::class,
             DatabaseCommand::class,
-            LogCommand::class])
+            LogCommand::class,
+            TraceCommand::class])
 class Cli : Callable<Int> {
 
   @Option(
@@ -407,3 +408,26 @@ class LogCommand {
     return OutputFormatter.print(VectorIPC.transmit(req), parent.json)
   }
 }
+
+@Command(name = "trace", description = ["Inspect hook dispatch traces of running processes"])
+class TraceCommand {
+  @ParentCommand lateinit var parent: Cli
+
+  @Command(name = "dump", description = ["Print the latest hook trace events of a process"])
+  fun dump(
+      @Parameters(paramLabel = "PID") pid: Int,
+      @Option(
+          names = ["-n", "--limit"],
+          defaultValue = "200",
+          description = ["Number of events to print"])
+      limit: Int
+  ): Int {
+    val req =
+        CliRequest(
+            command = "trace",
+            action = "dump",
+            targets = listOf(pid.toString()),
+            options = mapOf("limit" to limit))
+    return OutputFormatter.print(VectorIPC.transmit(req), parent.json)
+  }
+}
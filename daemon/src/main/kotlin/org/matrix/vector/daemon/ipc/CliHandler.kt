@@ -11,6 +11,7 @@ import org.matrix.vector.daemon.CliResponse
 import org.matrix.vector.daemon.data.ConfigCache
 import org.matrix.vector.daemon.data.ModuleDatabase
 import org.matrix.vector.daemon.data.PreferenceStore
+import org.matrix.vector.daemon.system.HookTraceReader
 
 object CliHandler {
 
@@ -28,6 +29,7 @@ object CliHandler {
             "config" -> handleConfig(request)
             "db" -> handleDatabase(request)
             "log" -> handleLog(request)
+            "trace" -> handleTrace(request)
             else -> throw IllegalArgumentException("Unknown command: ${request.command}")
           }
       CliResponse(success = true, data = responseData)
@@ -278,4 +280,29 @@ object CliHandler {
       else -> throw IllegalArgumentException("Unknown log action: ${request.action}")
     }
   }
+
+  private fun handleTrace(request: CliRequest): Any {
+    return when (request.action) {
+      "dump" -> {
+        val pid =
+            request.targets.firstOrNull()?.toIntOrNull()
+                ?: throw IllegalArgumentException("Process id required.")
+        val limit = (request.options["limit"] as? Number)?.toInt() ?: 200
+        val events =
+            HookTraceReader.read(pid, limit)
+                ?: throw IllegalArgumentException("Process $pid is not recording a hook trace.")
+        events.map {
+          mapOf(
+              "START_NS" to it.startNanos,
+              "TID" to it.tid,
+              "CALLBACKS" to it.callbacks,
+              "BEFORE_US" to it.beforeNanos / 1000,
+              "ORIGINAL_US" to it.originalNanos / 1000,
+              "AFTER_US" to it.afterNanos / 1000,
+              "METHOD" to (it.method ?: "?"))
+        }
+      }
+      else -> throw IllegalArgumentException("Unknown trace action: ${request.action}")
+    }
+  }
 }
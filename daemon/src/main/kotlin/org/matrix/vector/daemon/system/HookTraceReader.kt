@@ -0,0 +1,110 @@
+package org.matrix.vector.daemon.system
+
+import android.system.Os
+import java.io.File
+import java.io.RandomAccessFile
+import java.nio.ByteOrder
+import java.nio.MappedByteBuffer
+import java.nio.channels.FileChannel
+
+/**
+ * Reads the hook trace a process records with `HookBridge.startHookTrace`, straight out of its
+ * memory.
+ *
+ * The trace is a memfd the process keeps open, so it shows up among `/proc/<pid>/fd` and the daemon,
+ * running as root, can map it from there. Nothing is asked of the process: a dump works on one that
+ * is frozen, busy or wedged, which is usually the one whose latency is in question.
+ *
+ * The layout is `HookTrace` in hook_bridge.cpp, and this has to change with it.
+ */
+object HookTraceReader {
+
+  private const val MEMFD_NAME = "/memfd:vector-hook-trace"
+  private const val MAGIC = 0x52544856
+  private const val VERSION = 1
+
+  // Header offsets.
+  private const val HEADER_SIZE = 8
+  private const val RECORD_SIZE = 12
+  private const val CAPACITY = 16
+  private const val METHOD_CAPACITY = 20
+  private const val METHOD_NAME_SIZE = 24
+  private const val HEAD = 32
+  private const val METHOD_COUNT = 40
+
+  data class Event(
+      val startNanos: Long,
+      val tid: Int,
+      val method: String?,
+      val callbacks: Int,
+      val beforeNanos: Long,
+      val originalNanos: Long,
+      val afterNanos: Long,
+  )
+
+  /**
+   * The last [limit] events [pid] recorded, oldest first, or null when it has never started a
+   * trace. Events being written while this runs are left out rather than returned half-written.
+   */
+  fun read(pid: Int, limit: Int): List<Event>? {
+    val fd = findTrace(pid) ?: return null
+    val buffer =
+        RandomAccessFile(fd, "r").use { file ->
+          file.channel.map(FileChannel.MapMode.READ_ONLY, 0, file.length())
+        }
+    buffer.order(ByteOrder.nativeOrder())
+    if (buffer.getInt(0) != MAGIC) return null
+    if (buffer.getInt(4) != VERSION) {
+      throw IllegalStateException("Process $pid writes hook trace version ${buffer.getInt(4)}")
+    }
+
+    val headerSize = buffer.getInt(HEADER_SIZE)
+    val recordSize = buffer.getInt(RECORD_SIZE)
+    val capacity = buffer.getInt(CAPACITY)
+    val nameSize = buffer.getInt(METHOD_NAME_SIZE)
+    val records = headerSize + buffer.getInt(METHOD_CAPACITY) * nameSize
+    val methods = readMethods(buffer, headerSize, nameSize, buffer.getInt(METHOD_COUNT))
+
+    val head = buffer.getLong(HEAD)
+    val first = maxOf(0L, head - minOf(capacity, limit))
+    val events = ArrayList<Event>((head - first).toInt())
+    for (claim in first until head) {
+      val offset = records + (claim and (capacity - 1L)).toInt() * recordSize
+      // A writer zeroes the sequence before it writes and sets it to its claim + 1 after; the same
+      // value on both sides of the copy means the copy is whole.
+      if (buffer.getLong(offset) != claim + 1) continue
+      val event =
+          Event(
+              startNanos = buffer.getLong(offset + 8),
+              beforeNanos = buffer.getLong(offset + 16),
+              originalNanos = buffer.getLong(offset + 24),
+              afterNanos = buffer.getLong(offset + 32),
+              tid = buffer.getInt(offset + 40),
+              method = methods.getOrNull(buffer.getInt(offset + 44) - 1),
+              callbacks = buffer.getInt(offset + 48),
+          )
+      if (buffer.getLong(offset) != claim + 1) continue
+      events.add(event)
+    }
+    return events
+  }
+
+  private fun findTrace(pid: Int): File? =
+      File("/proc/$pid/fd").listFiles()?.firstOrNull { fd ->
+        runCatching { Os.readlink(fd.path).startsWith(MEMFD_NAME) }.getOrDefault(false)
+      }
+
+  private fun readMethods(
+      buffer: MappedByteBuffer,
+      offset: Int,
+      nameSize: Int,
+      count: Int
+  ): List<String> =
+      List(count) { index ->
+        val bytes = ByteArray(nameSize)
+        buffer.position(offset + index * nameSize)
+        buffer.get(bytes)
+        val length = bytes.indexOf(0).takeIf { it >= 0 } ?: nameSize
+        String(bytes, 0, length, Charsets.UTF_8)
+      }
+}
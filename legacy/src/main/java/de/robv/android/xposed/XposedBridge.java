@@ -18,8 +18,10 @@ import java.lang.reflect.Member;
 import java.lang.reflect.Method;
 import java.lang.reflect.Modifier;
 import java.lang.reflect.Proxy;
+import java.util.ArrayList;
 import java.util.Arrays;
 import java.util.HashSet;
+import java.util.List;
 import java.util.Set;
 import java.util.concurrent.CopyOnWriteArraySet;
 
@@ -173,6 +175,21 @@ public final class XposedBridge {
      * @see #hookAllConstructors
      */
     public static XC_MethodHook.Unhook hookMethod(Member hookMethod, XC_MethodHook callback) {
+        checkHookable(hookMethod);
+
+        if (callback == null) {
+            throw new IllegalArgumentException("callback should not be null!");
+        }
+
+        if (!HookBridge.hookMethod(false, (Executable) hookMethod, VectorNativeHooker.class, callback.priority, callback, callback.getClass().getClassLoader())) {
+            log("Failed to hook " + hookMethod);
+            return null;
+        }
+
+        return callback.new Unhook(hookMethod);
+    }
+
+    private static void checkHookable(Member hookMethod) {
         if (!(hookMethod instanceof Executable)) {
             throw new IllegalArgumentException("Only methods and constructors can be hooked, not " + hookMethod);
         } else if (Modifier.isAbstract(hookMethod.getModifiers())) {
@@ -186,17 +203,42 @@ public final class XposedBridge {
             // calls it entering every hooked method; a hook here re-enters the dispatch. See #798.
             throw new IllegalArgumentException("Object.getClass cannot be hooked: Vector's dispatch calls it entering every hooked method, so a hook here would call itself forever.");
         }
+    }
+
+    /**
+     * Hooks every member of {@code hookMethods} with the same callback in a single native call,
+     * which is what makes hooking hundreds of overloads cheap. Every member is checked before any
+     * is hooked, and a member that fails to hook contributes {@code null}, as {@link #hookMethod}
+     * returns for it.
+     */
+    private static Set<XC_MethodHook.Unhook> hookAll(Member[] hookMethods, XC_MethodHook callback) {
+        for (Member hookMethod : hookMethods) {
+            checkHookable(hookMethod);
+        }
+
+        Set<XC_MethodHook.Unhook> unhooks = new HashSet<>();
+        if (hookMethods.length == 0) {
+            return unhooks;
+        }
 
         if (callback == null) {
             throw new IllegalArgumentException("callback should not be null!");
         }
 
-        if (!HookBridge.hookMethod(false, (Executable) hookMethod, VectorNativeHooker.class, callback.priority, callback)) {
-            log("Failed to hook " + hookMethod);
-            return null;
+        Executable[] executables = new Executable[hookMethods.length];
+        for (int i = 0; i < hookMethods.length; i++) {
+            executables[i] = (Executable) hookMethods[i];
         }
-
-        return callback.new Unhook(hookMethod);
+        boolean[] hooked = HookBridge.hookMethods(false, executables, VectorNativeHooker.class, callback.priority, callback, callback.getClass().getClassLoader());
+        for (int i = 0; i < hookMethods.length; i++) {
+            if (hooked[i]) {
+                unhooks.add(callback.new Unhook(hookMethods[i]));
+            } else {
+                log("Failed to hook " + hookMethods[i]);
+                unhooks.add(null);
+            }
+        }
+        return unhooks;
     }
 
     /**
@@ -226,11 +268,11 @@ public final class XposedBridge {
      */
     @SuppressWarnings("UnusedReturnValue")
     public static Set<XC_MethodHook.Unhook> hookAllMethods(Class<?> hookClass, String methodName, XC_MethodHook callback) {
-        Set<XC_MethodHook.Unhook> unhooks = new HashSet<>();
+        List<Member> methods = new ArrayList<>();
         for (Member method : hookClass.getDeclaredMethods())
             if (method.getName().equals(methodName))
-                unhooks.add(hookMethod(method, callback));
-        return unhooks;
+                methods.add(method);
+        return hookAll(methods.toArray(new Member[0]), callback);
     }
 
     /**
@@ -242,10 +284,7 @@ public final class XposedBridge {
      */
     @SuppressWarnings("UnusedReturnValue")
     public static Set<XC_MethodHook.Unhook> hookAllConstructors(Class<?> hookClass, XC_MethodHook callback) {
-        Set<XC_MethodHook.Unhook> unhooks = new HashSet<>();
-        for (Member constructor : hookClass.getDeclaredConstructors())
-            unhooks.add(hookMethod(constructor, callback));
-        return unhooks;
+        return hookAll(hookClass.getDeclaredConstructors(), callback);
     }
 
     /**
@@ -8,6 +8,8 @@ import androidx.annotation.Nullable;
 
 import org.apache.commons.lang3.ClassUtilsX;
 import org.apache.commons.lang3.reflect.MemberUtilsX;
+import org.matrix.vector.impl.utils.VectorFieldAccessor;
+import org.matrix.vector.impl.utils.VectorMemberResolver;
 import org.matrix.vector.nativebridge.HookBridge;
 
 import java.io.ByteArrayOutputStream;
@@ -40,7 +42,7 @@ public final class XposedHelpers {
     private XposedHelpers() {
     }
 
-    private static final ConcurrentHashMap<MemberCacheKey.Field, Optional<Field>> fieldCache = new ConcurrentHashMap<>();
+    private static final ConcurrentHashMap<MemberCacheKey.Field, Optional<VectorFieldAccessor>> fieldCache = new ConcurrentHashMap<>();
     private static final ConcurrentHashMap<MemberCacheKey.Method, Optional<Method>> methodCache = new ConcurrentHashMap<>();
     private static final ConcurrentHashMap<MemberCacheKey.Constructor, Optional<Constructor<?>>> constructorCache = new ConcurrentHashMap<>();
     private static final WeakHashMap<Object, HashMap<String, Object>> additionalFields = new WeakHashMap<>();
@@ -198,11 +200,43 @@ public final class XposedHelpers {
      * @return A reference to the class, or {@code null} if it doesn't exist.
      */
     public static Class<?> findClassIfExists(String className, ClassLoader classLoader) {
-        try {
-            return findClass(className, classLoader);
-        } catch (ClassNotFoundError e) {
-            return null;
+        // Primitive names and array syntax are left to findClass, which knows them.
+        if (className.indexOf('.') < 0 || className.indexOf('[') >= 0) {
+            try {
+                return findClass(className, classLoader);
+            } catch (ClassNotFoundError e) {
+                return null;
+            }
+        }
+        if (classLoader == null)
+            classLoader = XposedBridge.BOOTCLASSLOADER;
+
+        // The native lookup remembers what a loader does not have, so modules probing for the same
+        // optional classes on every package load only pay for the ClassNotFoundException once.
+        Class<?> clazz = HookBridge.findClasses(classLoader, new String[]{className})[0];
+        if (clazz != null)
+            return clazz;
+
+        // Like findClass, take a nested class by its canonical name too, trying each dot from the
+        // right as a '$', all in one more call.
+        int dots = 0;
+        for (int i = 0; i < className.length(); i++) {
+            if (className.charAt(i) == '.')
+                dots++;
+        }
+        String[] nestedNames = new String[dots];
+        char[] chars = className.toCharArray();
+        for (int i = chars.length - 1, n = 0; i >= 0; i--) {
+            if (chars[i] == '.') {
+                chars[i] = '$';
+                nestedNames[n++] = new String(chars);
+            }
+        }
+        for (Class<?> nested : HookBridge.findClasses(classLoader, nestedNames)) {
+            if (nested != null)
+                return nested;
         }
+        return null;
     }
 
     /**
@@ -214,13 +248,21 @@ public final class XposedHelpers {
      * @throws NoSuchFieldError In case the field was not found.
      */
     public static Field findField(Class<?> clazz, String fieldName) {
+        return findAccessor(clazz, fieldName).getField();
+    }
+
+    /**
+     * Like {@link #findField}, but returns the cached native accessor the get/set helpers below
+     * go through.
+     */
+    private static VectorFieldAccessor findAccessor(Class<?> clazz, String fieldName) {
         var key = new MemberCacheKey.Field(clazz, fieldName);
 
         return fieldCache.computeIfAbsent(key, k -> {
             try {
                 Field newField = findFieldRecursiveImpl(k.clazz, k.name);
                 newField.setAccessible(true);
-                return Optional.of(newField);
+                return Optional.of(VectorFieldAccessor.of(newField));
             } catch (NoSuchFieldException e) {
                 return Optional.empty();
             }
@@ -626,6 +668,39 @@ public final class XposedHelpers {
         return clazzes;
     }
 
+    /**
+     * Returns the JNI signature of a constructor taking the given parameter types, or {@code null}
+     * if one of them is {@code null}.
+     */
+    private static String getJniSignature(Class<?>... parameterTypes) {
+        StringBuilder sb = new StringBuilder("(");
+        for (Class<?> type : parameterTypes) {
+            if (type == null)
+                return null;
+            else if (type.isArray())
+                sb.append(type.getName().replace('.', '/'));
+            else if (type == boolean.class)
+                sb.append('Z');
+            else if (type == byte.class)
+                sb.append('B');
+            else if (type == char.class)
+                sb.append('C');
+            else if (type == short.class)
+                sb.append('S');
+            else if (type == int.class)
+                sb.append('I');
+            else if (type == long.class)
+                sb.append('J');
+            else if (type == float.class)
+                sb.append('F');
+            else if (type == double.class)
+                sb.append('D');
+            else
+                sb.append('L').append(type.getName().replace('.', '/')).append(';');
+        }
+        return sb.append(")V").toString();
+    }
+
     private static String getParametersString(Class<?>... clazzes) {
         StringBuilder sb = new StringBuilder("(");
         boolean first = true;
@@ -692,13 +767,16 @@ public final class XposedHelpers {
         var key = new MemberCacheKey.Constructor(clazz, parameterTypes, true);
 
         return constructorCache.computeIfAbsent(key, k -> {
-            try {
-                Constructor<?> constructor = k.clazz.getDeclaredConstructor(k.parameters);
-                constructor.setAccessible(true);
-                return Optional.of(constructor);
-            } catch (NoSuchMethodException e) {
+            var signature = getJniSignature(k.parameters);
+            if (signature == null)
                 return Optional.empty();
-            }
+            // By method ID rather than a scan of the constructors, where the class allows it.
+            var constructor = (Constructor<?>) VectorMemberResolver.resolve(k.clazz, "<init>", signature);
+            // A signature names its types, so it can also match types of another loader.
+            if (constructor == null || !Arrays.equals(constructor.getParameterTypes(), k.parameters))
+                return Optional.empty();
+            constructor.setAccessible(true);
+            return Optional.of(constructor);
         }).orElseThrow(() -> new NoSuchMethodError(key.toString()));
     }
 
@@ -869,7 +947,7 @@ public final class XposedHelpers {
      */
     public static void setObjectField(Object obj, String fieldName, Object value) {
         try {
-            findField(obj.getClass(), fieldName).set(obj, value);
+            findAccessor(obj.getClass(), fieldName).set(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -884,7 +962,7 @@ public final class XposedHelpers {
      */
     public static void setBooleanField(Object obj, String fieldName, boolean value) {
         try {
-            findField(obj.getClass(), fieldName).setBoolean(obj, value);
+            findAccessor(obj.getClass(), fieldName).setBoolean(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -899,7 +977,7 @@ public final class XposedHelpers {
      */
     public static void setByteField(Object obj, String fieldName, byte value) {
         try {
-            findField(obj.getClass(), fieldName).setByte(obj, value);
+            findAccessor(obj.getClass(), fieldName).setByte(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -914,7 +992,7 @@ public final class XposedHelpers {
      */
     public static void setCharField(Object obj, String fieldName, char value) {
         try {
-            findField(obj.getClass(), fieldName).setChar(obj, value);
+            findAccessor(obj.getClass(), fieldName).setChar(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -929,7 +1007,7 @@ public final class XposedHelpers {
      */
     public static void setDoubleField(Object obj, String fieldName, double value) {
         try {
-            findField(obj.getClass(), fieldName).setDouble(obj, value);
+            findAccessor(obj.getClass(), fieldName).setDouble(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -944,7 +1022,7 @@ public final class XposedHelpers {
      */
     public static void setFloatField(Object obj, String fieldName, float value) {
         try {
-            findField(obj.getClass(), fieldName).setFloat(obj, value);
+            findAccessor(obj.getClass(), fieldName).setFloat(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -959,7 +1037,7 @@ public final class XposedHelpers {
      */
     public static void setIntField(Object obj, String fieldName, int value) {
         try {
-            findField(obj.getClass(), fieldName).setInt(obj, value);
+            findAccessor(obj.getClass(), fieldName).setInt(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -974,7 +1052,7 @@ public final class XposedHelpers {
      */
     public static void setLongField(Object obj, String fieldName, long value) {
         try {
-            findField(obj.getClass(), fieldName).setLong(obj, value);
+            findAccessor(obj.getClass(), fieldName).setLong(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -989,7 +1067,7 @@ public final class XposedHelpers {
      */
     public static void setShortField(Object obj, String fieldName, short value) {
         try {
-            findField(obj.getClass(), fieldName).setShort(obj, value);
+            findAccessor(obj.getClass(), fieldName).setShort(obj, value);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1006,7 +1084,7 @@ public final class XposedHelpers {
      */
     public static Object getObjectField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).get(obj);
+            return findAccessor(obj.getClass(), fieldName).get(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1029,7 +1107,7 @@ public final class XposedHelpers {
     @SuppressWarnings("BooleanMethodIsAlwaysInverted")
     public static boolean getBooleanField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).getBoolean(obj);
+            return findAccessor(obj.getClass(), fieldName).getBoolean(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1044,7 +1122,7 @@ public final class XposedHelpers {
      */
     public static byte getByteField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).getByte(obj);
+            return findAccessor(obj.getClass(), fieldName).getByte(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1059,7 +1137,7 @@ public final class XposedHelpers {
      */
     public static char getCharField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).getChar(obj);
+            return findAccessor(obj.getClass(), fieldName).getChar(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1074,7 +1152,7 @@ public final class XposedHelpers {
      */
     public static double getDoubleField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).getDouble(obj);
+            return findAccessor(obj.getClass(), fieldName).getDouble(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1089,7 +1167,7 @@ public final class XposedHelpers {
      */
     public static float getFloatField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).getFloat(obj);
+            return findAccessor(obj.getClass(), fieldName).getFloat(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1104,7 +1182,7 @@ public final class XposedHelpers {
      */
     public static int getIntField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).getInt(obj);
+            return findAccessor(obj.getClass(), fieldName).getInt(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1119,7 +1197,7 @@ public final class XposedHelpers {
      */
     public static long getLongField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).getLong(obj);
+            return findAccessor(obj.getClass(), fieldName).getLong(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1134,7 +1212,7 @@ public final class XposedHelpers {
      */
     public static short getShortField(Object obj, String fieldName) {
         try {
-            return findField(obj.getClass(), fieldName).getShort(obj);
+            return findAccessor(obj.getClass(), fieldName).getShort(obj);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1150,11 +1228,11 @@ public final class XposedHelpers {
      * Sets the value of a static object field in the given class. See also {@link #findField}.
      */
     public static void setStaticObjectField(Class<?> clazz, String fieldName, Object value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.set(null, value);
+            accessor.set(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1164,11 +1242,11 @@ public final class XposedHelpers {
      * Sets the value of a static {@code boolean} field in the given class. See also {@link #findField}.
      */
     public static void setStaticBooleanField(Class<?> clazz, String fieldName, boolean value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.setBoolean(null, value);
+            accessor.setBoolean(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1178,11 +1256,11 @@ public final class XposedHelpers {
      * Sets the value of a static {@code byte} field in the given class. See also {@link #findField}.
      */
     public static void setStaticByteField(Class<?> clazz, String fieldName, byte value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.setByte(null, value);
+            accessor.setByte(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1192,11 +1270,11 @@ public final class XposedHelpers {
      * Sets the value of a static {@code char} field in the given class. See also {@link #findField}.
      */
     public static void setStaticCharField(Class<?> clazz, String fieldName, char value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.setChar(null, value);
+            accessor.setChar(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1206,11 +1284,11 @@ public final class XposedHelpers {
      * Sets the value of a static {@code double} field in the given class. See also {@link #findField}.
      */
     public static void setStaticDoubleField(Class<?> clazz, String fieldName, double value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.setDouble(null, value);
+            accessor.setDouble(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1220,11 +1298,11 @@ public final class XposedHelpers {
      * Sets the value of a static {@code float} field in the given class. See also {@link #findField}.
      */
     public static void setStaticFloatField(Class<?> clazz, String fieldName, float value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.setFloat(null, value);
+            accessor.setFloat(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1234,11 +1312,11 @@ public final class XposedHelpers {
      * Sets the value of a static {@code int} field in the given class. See also {@link #findField}.
      */
     public static void setStaticIntField(Class<?> clazz, String fieldName, int value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.setInt(null, value);
+            accessor.setInt(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1248,11 +1326,11 @@ public final class XposedHelpers {
      * Sets the value of a static {@code long} field in the given class. See also {@link #findField}.
      */
     public static void setStaticLongField(Class<?> clazz, String fieldName, long value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.setLong(null, value);
+            accessor.setLong(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1262,11 +1340,11 @@ public final class XposedHelpers {
      * Sets the value of a static {@code short} field in the given class. See also {@link #findField}.
      */
     public static void setStaticShortField(Class<?> clazz, String fieldName, short value) {
-        Field field = findField(clazz, fieldName);
+        var accessor = findAccessor(clazz, fieldName);
         try {
-            field.setShort(null, value);
+            accessor.setShort(null, value);
         } catch (IllegalAccessException e) {
-            setStaticFinalField(field, value, e);
+            setStaticFinalField(accessor.getField(), value, e);
         } catch (IllegalArgumentException e) {
             throw e;
         }
@@ -1310,7 +1388,7 @@ public final class XposedHelpers {
      */
     public static Object getStaticObjectField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).get(null);
+            return findAccessor(clazz, fieldName).get(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1325,7 +1403,7 @@ public final class XposedHelpers {
      */
     public static boolean getStaticBooleanField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).getBoolean(null);
+            return findAccessor(clazz, fieldName).getBoolean(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1340,7 +1418,7 @@ public final class XposedHelpers {
      */
     public static byte getStaticByteField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).getByte(null);
+            return findAccessor(clazz, fieldName).getByte(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1355,7 +1433,7 @@ public final class XposedHelpers {
      */
     public static char getStaticCharField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).getChar(null);
+            return findAccessor(clazz, fieldName).getChar(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1370,7 +1448,7 @@ public final class XposedHelpers {
      */
     public static double getStaticDoubleField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).getDouble(null);
+            return findAccessor(clazz, fieldName).getDouble(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1385,7 +1463,7 @@ public final class XposedHelpers {
      */
     public static float getStaticFloatField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).getFloat(null);
+            return findAccessor(clazz, fieldName).getFloat(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1400,7 +1478,7 @@ public final class XposedHelpers {
      */
     public static int getStaticIntField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).getInt(null);
+            return findAccessor(clazz, fieldName).getInt(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1415,7 +1493,7 @@ public final class XposedHelpers {
      */
     public static long getStaticLongField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).getLong(null);
+            return findAccessor(clazz, fieldName).getLong(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
@@ -1430,7 +1508,7 @@ public final class XposedHelpers {
      */
     public static short getStaticShortField(Class<?> clazz, String fieldName) {
         try {
-            return findField(clazz, fieldName).getShort(null);
+            return findAccessor(clazz, fieldName).getShort(null);
         } catch (IllegalAccessException e) {
             // should not happen
             XposedBridge.log(e);
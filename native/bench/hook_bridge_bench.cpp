@@ -0,0 +1,556 @@
+/**
+ * @file hook_bridge_bench.cpp
+ * @brief Microbenchmarks of the hook registry at 1 to 16 threads, run on the host.
+ *
+ * The bridge is compiled into this file as it is, over the stand-in JNI of stub/jni.h, and driven
+ * through the same entry points the Java side calls. What gets measured is the registry's own
+ * synchronisation: the epoch domain, HookIndex, the monitor on a hook's backup and the publication
+ * of its snapshot. The runtime's share (reference tables, lsplant installing a trampoline, the
+ * upcall into the hooker) is not, so a device adds that on top of every figure here.
+ *
+ * Usage: hook_bridge_bench [--quick] [filter]
+ *
+ * Only benchmarks whose name contains [filter] are run. --quick cuts every operation count by
+ * twenty, which is enough to see that everything still works but too little for stable numbers.
+ */
+
+#include "jni/hook_bridge.cpp"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <latch>
+#include <map>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace vector::native {
+// Defined in core/ for the Android build. Nothing here creates a Context, so registration stops
+// after the bridge has cached its classes, and no native is actually registered.
+std::unique_ptr<ConfigBridge> ConfigBridge::instance_;
+std::unique_ptr<Context> Context::instance_;
+
+Context *Context::GetInstance() { return instance_.get(); }
+
+lsplant::ScopedLocalRef<jclass> Context::FindClassFromLoader(JNIEnv *env, jobject,
+                                                             std::string_view) {
+    return {env, nullptr};
+}
+
+jobjectArray Context::FindClassesFromLoader(JNIEnv *, jobject, jobjectArray) { return nullptr; }
+}  // namespace vector::native
+
+namespace {
+
+using namespace vector::native::jni;
+using Clock = std::chrono::steady_clock;
+
+constexpr int kThreadCounts[] = {1, 2, 4, 8, 16};
+// Hooked methods every thread spreads its calls over in the shared-hook benchmarks.
+constexpr size_t kHotMethods = 64;
+
+struct Options {
+    bool quick = false;
+    std::string_view filter;
+} options;
+
+jclass hooker;
+jobject owner;
+
+/// [full], or a twentieth of it under --quick.
+size_t Ops(size_t full) { return options.quick ? std::max<size_t>(full / 20, 1) : full; }
+
+struct Result {
+    double ns_per_op;  // Wall time of one operation on one thread.
+    double mops;       // Operations per second across all threads, in millions.
+};
+
+/**
+ * @brief Runs [body](env, thread, ops) on [threads] threads released at once, and times them from
+ * the release until the last one has finished.
+ */
+template <class Body>
+Result Run(int threads, size_t ops, Body &&body) {
+    std::latch ready(threads);
+    std::latch go(1);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            JNIEnv env;
+            ready.count_down();
+            go.wait();
+            body(&env, t, ops);
+        });
+    }
+    ready.wait();
+    auto start = Clock::now();
+    go.count_down();
+    for (auto &worker : workers) worker.join();
+    double elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return {elapsed / static_cast<double>(ops),
+            static_cast<double>(ops) * threads / elapsed * 1e3};
+}
+
+void Report(std::string_view name, int threads, const Result &result) {
+    std::printf("%-28.*s %7d %12.1f %12.2f\n", static_cast<int>(name.size()), name.data(),
+                threads, result.ns_per_op, result.mops);
+    std::fflush(stdout);
+}
+
+jobject NewCallback() { return fakejni::New(fakejni::Class("java/lang/Object")); }
+
+bool Hook(JNIEnv *env, jobject method, jobject callback) {
+    return Java_org_matrix_vector_nativebridge_HookBridge_hookMethod(
+        env, nullptr, JNI_TRUE, method, hooker, 0, callback, owner);
+}
+
+bool Unhook(JNIEnv *env, jobject method, jobject callback) {
+    return Java_org_matrix_vector_nativebridge_HookBridge_unhookMethod(env, nullptr, JNI_TRUE,
+                                                                       method, callback);
+}
+
+/// Removes every hook left without callbacks, so that one benchmark does not slow the next.
+void ReclaimAll(JNIEnv *env) {
+    Java_org_matrix_vector_nativebridge_HookBridge_setIdleHookTimeout(env, nullptr, 0);
+    Java_org_matrix_vector_nativebridge_HookBridge_reclaimIdleHooks(env, nullptr);
+    Java_org_matrix_vector_nativebridge_HookBridge_setIdleHookTimeout(env, nullptr, 10'000);
+}
+
+/**
+ * @struct HotMethods
+ * @brief Fresh methods hooked with one callback each, and the handles their hookers would hold.
+ */
+struct HotMethods {
+    std::vector<jobject> methods;
+    std::vector<jlong> handles;
+    jobject callback = NewCallback();
+
+    HotMethods(JNIEnv *env, size_t count) {
+        for (size_t i = 0; i < count; ++i) {
+            methods.push_back(fakejni::NewMethod("hot" + std::to_string(i)));
+            Hook(env, methods.back(), callback);
+            EpochDomain::Guard guard;
+            handles.push_back(
+                hooked_methods.FindCell(env->FromReflectedMethod(methods.back()))->Handle());
+        }
+    }
+
+    /// Hooks [extra] on every method.
+    void Add(JNIEnv *env, jobject extra) {
+        for (auto *method : methods) Hook(env, method, extra);
+    }
+
+    /// Unhooks [extra] from every method it is still on.
+    void Remove(JNIEnv *env, jobject extra) {
+        for (auto *method : methods) Unhook(env, method, extra);
+    }
+
+    void Release(JNIEnv *env) {
+        Remove(env, callback);
+        for (auto *method : methods) env->DeleteLocalRef(method);
+        env->DeleteLocalRef(callback);
+        ReclaimAll(env);
+    }
+};
+
+/// Entering and leaving a read-side section, as every hooked call does at least once.
+Result EpochGuard(JNIEnv *, int threads) {
+    return Run(threads, Ops(20'000'000), [](JNIEnv *, int, size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            EpochDomain::Guard guard;
+            asm volatile("" ::: "memory");
+        }
+    });
+}
+
+/// Retiring an object, as every snapshot publication does with the one it replaces.
+Result EpochRetire(JNIEnv *, int threads) {
+    return Run(threads, Ops(500'000), [](JNIEnv *env, int, size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            EpochDomain::Instance().Retire(env, new int(0), [](JNIEnv *, void *ptr) {
+                delete static_cast<int *>(ptr);
+            });
+        }
+    });
+}
+
+/// hookMethod on methods that were not hooked yet, every thread on methods of its own.
+Result Install(JNIEnv *env, int threads) {
+    const size_t ops = Ops(20'000);
+    // Made up front, so that the loop times hookMethod alone.
+    std::vector<std::vector<jobject>> methods(threads);
+    for (int t = 0; t < threads; ++t) {
+        for (size_t i = 0; i < ops; ++i) {
+            methods[t].push_back(
+                fakejni::NewMethod("install" + std::to_string(t) + "." + std::to_string(i)));
+        }
+    }
+    auto *callback = NewCallback();
+
+    auto result = Run(threads, ops, [&](JNIEnv *env, int t, size_t ops) {
+        for (size_t i = 0; i < ops; ++i) Hook(env, methods[t][i], callback);
+    });
+
+    for (auto &list : methods) {
+        for (auto *method : list) {
+            Unhook(env, method, callback);
+            env->DeleteLocalRef(method);
+        }
+    }
+    env->DeleteLocalRef(callback);
+    ReclaimAll(env);
+    return result;
+}
+
+/// handleCallbackSnapshot by handle, as every hooked call makes it, over hooks shared by all.
+Result Snapshot(JNIEnv *env, int threads) {
+    HotMethods hot(env, kHotMethods);
+    auto *args = env->NewObjectArray(2, object_class, nullptr);
+
+    auto result = Run(threads, Ops(5'000'000), [&](JNIEnv *env, int t, size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            auto handle = hot.handles[(i + t * 7) % kHotMethods];
+            auto snapshot = Java_org_matrix_vector_nativebridge_HookBridge_handleCallbackSnapshot(
+                env, nullptr, handle, args, JNI_FALSE);
+            if (snapshot) env->DeleteLocalRef(snapshot);
+        }
+    });
+
+    env->DeleteLocalRef(args);
+    hot.Release(env);
+    return result;
+}
+
+/// Snapshot again, with one more thread replacing callbacks on the same hooks all the while.
+Result SnapshotUnderReplace(JNIEnv *env, int threads) {
+    HotMethods hot(env, kHotMethods);
+    auto *args = env->NewObjectArray(2, object_class, nullptr);
+    jobject swap[2] = {NewCallback(), NewCallback()};
+    hot.Add(env, swap[0]);
+
+    std::atomic<bool> done = false;
+    std::vector<bool> swapped(kHotMethods);
+    std::thread writer([&] {
+        JNIEnv env;
+        for (size_t i = 0; !done.load(std::memory_order_relaxed); ++i) {
+            auto m = i % kHotMethods;
+            Java_org_matrix_vector_nativebridge_HookBridge_replaceCallback(
+                &env, nullptr, JNI_TRUE, hot.methods[m], swap[swapped[m]], swap[!swapped[m]], 0);
+            swapped[m] = !swapped[m];
+        }
+    });
+
+    auto result = Run(threads, Ops(2'000'000), [&](JNIEnv *env, int t, size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            auto handle = hot.handles[(i + t * 7) % kHotMethods];
+            auto snapshot = Java_org_matrix_vector_nativebridge_HookBridge_handleCallbackSnapshot(
+                env, nullptr, handle, args, JNI_FALSE);
+            if (snapshot) env->DeleteLocalRef(snapshot);
+        }
+    });
+    done = true;
+    writer.join();
+
+    for (auto *callback : swap) {
+        hot.Remove(env, callback);
+        env->DeleteLocalRef(callback);
+    }
+    env->DeleteLocalRef(args);
+    hot.Release(env);
+    return result;
+}
+
+/// replaceCallback on hooks shared by all, every thread swapping a callback pair of its own.
+Result Replace(JNIEnv *env, int threads) {
+    HotMethods hot(env, kHotMethods);
+    std::vector<std::array<jobject, 2>> swap(threads);
+    for (auto &pair : swap) {
+        pair = {NewCallback(), NewCallback()};
+        hot.Add(env, pair[0]);
+    }
+
+    auto result = Run(threads, Ops(200'000), [&](JNIEnv *env, int t, size_t ops) {
+        std::vector<bool> swapped(kHotMethods);
+        for (size_t i = 0; i < ops; ++i) {
+            auto m = (i + t * 7) % kHotMethods;
+            Java_org_matrix_vector_nativebridge_HookBridge_replaceCallback(
+                env, nullptr, JNI_TRUE, hot.methods[m], swap[t][swapped[m]], swap[t][!swapped[m]],
+                0);
+            swapped[m] = !swapped[m];
+        }
+    });
+
+    for (auto &pair : swap) {
+        for (auto *callback : pair) {
+            hot.Remove(env, callback);
+            env->DeleteLocalRef(callback);
+        }
+    }
+    hot.Release(env);
+    return result;
+}
+
+/// unhookMethod then hookMethod of one callback on hooks shared by all, each thread its own.
+Result UnhookRehook(JNIEnv *env, int threads) {
+    HotMethods hot(env, kHotMethods);
+    std::vector<jobject> callbacks(threads);
+    for (auto &callback : callbacks) {
+        callback = NewCallback();
+        hot.Add(env, callback);
+    }
+
+    auto result = Run(threads, Ops(100'000), [&](JNIEnv *env, int t, size_t ops) {
+        for (size_t i = 0; i < ops; ++i) {
+            auto *method = hot.methods[(i + t * 7) % kHotMethods];
+            Unhook(env, method, callbacks[t]);
+            Hook(env, method, callbacks[t]);
+        }
+    });
+
+    for (auto *callback : callbacks) {
+        hot.Remove(env, callback);
+        env->DeleteLocalRef(callback);
+    }
+    hot.Release(env);
+    return result;
+}
+
+/**
+ * @struct MultimapCallbacks
+ * @brief A hook's callbacks as HookItem kept them before CallbackList, one tree node apiece.
+ */
+struct MultimapCallbacks {
+    std::multimap<jint, jobject, std::greater<>> legacy_callbacks;
+    std::multimap<jint, jobject, std::greater<>> modern_callbacks;
+
+    void Add(jint priority, jobject callback) { modern_callbacks.emplace(priority, callback); }
+};
+
+/// The same in the CallbackLists HookItem has now.
+struct ListCallbacks {
+    CallbackList legacy_callbacks;
+    CallbackList modern_callbacks;
+
+    void Add(jint priority, jobject callback) {
+        modern_callbacks.Insert(Callback{callback, 0, priority});
+    }
+};
+
+/**
+ * @brief Heap bytes one hook's callback storage takes with [callbacks] callbacks, the storage
+ * itself included: it lives inside a HookItem, which is allocated on its own.
+ */
+template <class Storage>
+double BytesPerHook(size_t hooks, int callbacks) {
+    std::vector<Storage *> storage;
+    storage.reserve(hooks);
+    const auto before = mallinfo2().uordblks;
+    for (size_t i = 0; i < hooks; ++i) {
+        auto *hook = new Storage;
+        for (int c = 0; c < callbacks; ++c) {
+            // Never dereferenced: only the entries' size matters here.
+            hook->Add(c % 2, reinterpret_cast<jobject>(static_cast<uintptr_t>(c + 1) * 16));
+        }
+        storage.push_back(hook);
+    }
+    const auto after = mallinfo2().uordblks;
+    for (auto *hook : storage) delete hook;
+    return static_cast<double>(after - before) / static_cast<double>(hooks);
+}
+
+/// The callback storage of one hook, before and after CallbackList, by number of callbacks.
+void CallbackMemory() {
+    const size_t hooks = Ops(100'000);
+    std::printf("\n%-28s %9s %16s %16s\n", "memory/callbacks", "callbacks", "multimap B/hook",
+                "CallbackList B/hook");
+    for (int callbacks : {1, 2, 4, 8}) {
+        std::printf("%-28s %9d %16.1f %16.1f\n", "", callbacks,
+                    BytesPerHook<MultimapCallbacks>(hooks, callbacks),
+                    BytesPerHook<ListCallbacks>(hooks, callbacks));
+    }
+    std::printf("(sizeof: multimap %zu B, CallbackList %zu B, per hook)\n",
+                sizeof(MultimapCallbacks), sizeof(ListCallbacks));
+}
+
+/**
+ * @struct Registries
+ * @brief The same hooked methods in a HookIndex and in the SharedHashMap hooked_methods was before
+ * it, for comparing lookups. Built once; nothing in them is ever dereferenced.
+ */
+struct Registries {
+    // About as many methods as a process with a few modules hooks.
+    static constexpr size_t kLookedUp = 1024;
+    // Hooked and unhooked over and over by the churn benchmarks, apart from those looked up.
+    static constexpr size_t kChurned = 256;
+
+    HookIndex index;
+    SharedHashMap<jmethodID, HookItem *> map;
+    std::vector<jmethodID> looked_up;
+    std::vector<jmethodID> churned;
+
+    static Registries &Get(JNIEnv *env) {
+        static Registries *registries = new Registries(env);
+        return *registries;
+    }
+
+    /// Inserts [target] into both, with an item standing for it.
+    void Insert(JNIEnv *env, jmethodID target) {
+        bool inserted = false;
+        EpochDomain::Guard guard;
+        // Never dereferenced, so any distinct pointer does; the index's argument is not needed.
+        auto *item = index.FindOrInsert(
+            env, target, [target](auto &&...) { return reinterpret_cast<HookItem *>(target); },
+            inserted);
+        map.lazy_emplace_l(
+            target, [](auto &) {}, [&](const auto &ctor) { ctor(target, item); });
+    }
+
+    void Erase(jmethodID target) {
+        EpochDomain::Guard guard;
+        index.Erase(target, index.Find(target));
+        map.erase_if(target, [](auto &) { return true; });
+    }
+
+private:
+    explicit Registries(JNIEnv *env) {
+        // Spaced like ArtMethods, which is all a lookup ever sees of them.
+        auto method = [](size_t i) {
+            return reinterpret_cast<jmethodID>(uintptr_t{0x70000000} + i * 32);
+        };
+        for (size_t i = 0; i < kLookedUp; ++i) looked_up.push_back(method(i));
+        for (size_t i = 0; i < kChurned; ++i) churned.push_back(method(kLookedUp + i));
+        for (auto target : looked_up) Insert(env, target);
+        for (auto target : churned) Insert(env, target);
+    }
+};
+
+/// The [i]th method thread [t] looks up, scattered so that threads do not walk in step.
+jmethodID LookedUp(const Registries &registries, int t, size_t i) {
+    auto n = static_cast<uint32_t>(i * 2654435761u + static_cast<uint32_t>(t) * 40503u);
+    return registries.looked_up[n % Registries::kLookedUp];
+}
+
+/// Keeps [value] from being optimised away.
+void Consume(uintptr_t value) { asm volatile("" : : "r"(value)); }
+
+Result LookupIndex(JNIEnv *env, int threads) {
+    auto &registries = Registries::Get(env);
+    return Run(threads, Ops(10'000'000), [&](JNIEnv *, int t, size_t ops) {
+        uintptr_t found = 0;
+        for (size_t i = 0; i < ops; ++i) {
+            EpochDomain::Guard guard;
+            found += reinterpret_cast<uintptr_t>(registries.index.Find(LookedUp(registries, t, i)));
+        }
+        Consume(found);
+    });
+}
+
+Result LookupSharedMap(JNIEnv *env, int threads) {
+    auto &registries = Registries::Get(env);
+    return Run(threads, Ops(10'000'000), [&](JNIEnv *, int t, size_t ops) {
+        uintptr_t found = 0;
+        for (size_t i = 0; i < ops; ++i) {
+            registries.map.if_contains(LookedUp(registries, t, i), [&found](const auto &it) {
+                found += reinterpret_cast<uintptr_t>(it.second);
+            });
+        }
+        Consume(found);
+    });
+}
+
+/**
+ * @brief Runs [lookup] while one more thread unhooks and rehooks the churned methods, in both
+ * registries, as a module being reloaded would.
+ */
+template <class Lookup>
+Result UnderChurn(JNIEnv *env, int threads, Lookup &&lookup) {
+    auto &registries = Registries::Get(env);
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        JNIEnv env;
+        for (size_t i = 0; !done.load(std::memory_order_relaxed); ++i) {
+            auto target = registries.churned[i % Registries::kChurned];
+            registries.Erase(target);
+            registries.Insert(&env, target);
+        }
+    });
+    auto result = lookup(env, threads);
+    done = true;
+    writer.join();
+    return result;
+}
+
+Result LookupIndexUnderChurn(JNIEnv *env, int threads) {
+    return UnderChurn(env, threads, LookupIndex);
+}
+
+Result LookupSharedMapUnderChurn(JNIEnv *env, int threads) {
+    return UnderChurn(env, threads, LookupSharedMap);
+}
+
+struct Benchmark {
+    std::string_view name;
+    Result (*run)(JNIEnv *env, int threads);
+};
+
+constexpr Benchmark kBenchmarks[] = {
+    {"epoch/guard", EpochGuard},
+    {"epoch/retire", EpochRetire},
+    {"install", Install},
+    {"snapshot", Snapshot},
+    {"snapshot/under-replace", SnapshotUnderReplace},
+    {"replace", Replace},
+    {"unhook+hook", UnhookRehook},
+    {"lookup/hook-index", LookupIndex},
+    {"lookup/shared-map", LookupSharedMap},
+    {"lookup/hook-index/churn", LookupIndexUnderChurn},
+    {"lookup/shared-map/churn", LookupSharedMapUnderChurn},
+};
+
+/// Measurements that are not a matter of threads, each printing a table of its own.
+struct Table {
+    std::string_view name;
+    void (*run)();
+};
+
+constexpr Table kTables[] = {
+    {"memory/callbacks", CallbackMemory},
+};
+
+}  // namespace
+
+int main(int argc, char **argv) {
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--quick") {
+            options.quick = true;
+        } else {
+            options.filter = arg;
+        }
+    }
+
+    JNIEnv env;
+    RegisterHookBridge(&env);
+    hooker = fakejni::Class("org/matrix/vector/impl/hooks/VectorNativeHooker");
+    owner = fakejni::New(fakejni::Class("dalvik/system/PathClassLoader"));
+
+    std::printf("%u hardware threads%s\n", std::thread::hardware_concurrency(),
+                options.quick ? ", quick run" : "");
+    std::printf("%-28s %7s %12s %12s\n", "benchmark", "threads", "ns/op", "Mops/s");
+    for (const auto &benchmark : kBenchmarks) {
+        if (benchmark.name.find(options.filter) == std::string_view::npos) continue;
+        for (int threads : kThreadCounts) {
+            Report(benchmark.name, threads, benchmark.run(&env, threads));
+        }
+    }
+    for (const auto &table : kTables) {
+        if (table.name.find(options.filter) == std::string_view::npos) continue;
+        table.run();
+    }
+    return 0;
+}
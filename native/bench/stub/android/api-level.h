@@ -0,0 +1,6 @@
+#pragma once
+
+#define __ANDROID_API_P__ 28
+
+/// The harness runs as the newest release the bridge branches on.
+inline int android_get_device_api_level() { return 34; }
@@ -0,0 +1,384 @@
+#pragma once
+
+/**
+ * @file jni.h
+ * @brief A stand-in for <jni.h> on the host, so the hook bridge can run without a VM.
+ *
+ * Only the part of JNI the bridge calls is here, over a toy object model: an object is a
+ * reference-counted heap node, and local, global and weak references are all the object pointer,
+ * each taking a count of its own. Classes and member IDs are interned by name, monitors are
+ * recursive mutexes and no exception is ever pending. Calls into Java do nothing and return zero.
+ *
+ * That is enough for the registry's own work (installing, publishing and reading snapshots,
+ * replacing and removing callbacks) to do what it does on a device, minus the runtime's cost.
+ */
+
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+typedef uint8_t jboolean;
+typedef int8_t jbyte;
+typedef uint16_t jchar;
+typedef int16_t jshort;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+typedef double jdouble;
+typedef jint jsize;
+
+class _jobject;
+class _jclass;
+
+namespace fakejni {
+inline _jobject *Retain(_jobject *object);
+inline void Release(_jobject *object);
+}  // namespace fakejni
+
+class _jobject {
+public:
+    _jobject() = default;
+    _jobject(const _jobject &) = delete;
+    _jobject &operator=(const _jobject &) = delete;
+    virtual ~_jobject() {
+        for (auto *element : elements) fakejni::Release(element);
+    }
+
+    std::atomic<int32_t> references{1};
+    _jclass *klass = nullptr;
+    std::vector<_jobject *> elements;  // An object array's elements, each holding a reference.
+    std::vector<int64_t> values;       // A primitive array's elements.
+    std::string utf;                   // A string's contents, ASCII only.
+    std::u16string chars;              // The same, as UTF-16.
+    struct _jmethodID *method = nullptr;  // What a reflected method stands for.
+    std::recursive_mutex monitor;
+};
+
+class _jclass : public _jobject {
+public:
+    std::string name;
+};
+class _jstring : public _jobject {};
+class _jarray : public _jobject {};
+class _jobjectArray : public _jarray {};
+class _jbooleanArray : public _jarray {};
+class _jbyteArray : public _jarray {};
+class _jcharArray : public _jarray {};
+class _jshortArray : public _jarray {};
+class _jintArray : public _jarray {};
+class _jlongArray : public _jarray {};
+class _jfloatArray : public _jarray {};
+class _jdoubleArray : public _jarray {};
+class _jthrowable : public _jobject {};
+
+typedef _jobject *jobject;
+typedef _jclass *jclass;
+typedef _jstring *jstring;
+typedef _jarray *jarray;
+typedef _jobjectArray *jobjectArray;
+typedef _jbooleanArray *jbooleanArray;
+typedef _jbyteArray *jbyteArray;
+typedef _jcharArray *jcharArray;
+typedef _jshortArray *jshortArray;
+typedef _jintArray *jintArray;
+typedef _jlongArray *jlongArray;
+typedef _jfloatArray *jfloatArray;
+typedef _jdoubleArray *jdoubleArray;
+typedef _jthrowable *jthrowable;
+typedef _jobject *jweak;
+
+struct _jmethodID {
+    std::string name;
+    std::string signature;
+};
+struct _jfieldID {
+    std::string name;
+    std::string signature;
+    jobject static_value = nullptr;  // Made on first read, for static fields.
+};
+typedef _jmethodID *jmethodID;
+typedef _jfieldID *jfieldID;
+
+typedef union jvalue {
+    jboolean z;
+    jbyte b;
+    jchar c;
+    jshort s;
+    jint i;
+    jlong j;
+    jfloat f;
+    jdouble d;
+    jobject l;
+} jvalue;
+
+typedef enum jobjectRefType {
+    JNIInvalidRefType = 0,
+    JNILocalRefType = 1,
+    JNIGlobalRefType = 2,
+    JNIWeakGlobalRefType = 3
+} jobjectRefType;
+
+typedef struct {
+    const char *name;
+    const char *signature;
+    void *fnPtr;
+} JNINativeMethod;
+
+#define JNI_FALSE 0
+#define JNI_TRUE 1
+#define JNI_OK 0
+#define JNI_ERR (-1)
+#define JNI_COMMIT 1
+#define JNI_ABORT 2
+#define JNIEXPORT __attribute__((visibility("default")))
+#define JNICALL
+#define JNI_VERSION_1_6 0x00010006
+
+namespace fakejni {
+
+inline _jobject *Retain(_jobject *object) {
+    if (object) object->references.fetch_add(1, std::memory_order_relaxed);
+    return object;
+}
+
+inline void Release(_jobject *object) {
+    if (object && object->references.fetch_sub(1, std::memory_order_acq_rel) == 1) delete object;
+}
+
+/// The class named [name], made on first use and never freed. Borrowed, not a new reference.
+inline jclass Class(const std::string &name) {
+    static std::mutex lock;
+    static std::map<std::string, jclass> classes;
+    std::lock_guard lk(lock);
+    auto &cls = classes[name];
+    if (!cls) {
+        cls = new _jclass;
+        cls->name = name;
+    }
+    return cls;
+}
+
+/// The member [name] of [cls] with [signature], made on first use and never freed.
+template <class Id>
+Id *Member(jclass cls, const char *name, const char *signature) {
+    static std::mutex lock;
+    static std::map<std::tuple<jclass, std::string, std::string>, Id *> members;
+    std::lock_guard lk(lock);
+    auto &member = members[{cls, name, signature}];
+    if (!member) member = new Id{name, signature};
+    return member;
+}
+
+/// A new object of [cls], as a local reference.
+template <class T = _jobject>
+T *New(jclass cls) {
+    auto *object = new T;
+    object->klass = cls;
+    return object;
+}
+
+/// A reflected method standing for a fresh method ID named [name], as a local reference. The ID
+/// is never freed, as an ArtMethod is not: the registry keys its cells by it for good.
+inline jobject NewMethod(const std::string &name) {
+    auto *object = New(Class("java/lang/reflect/Method"));
+    object->method = new _jmethodID{name, "()V"};
+    return object;
+}
+
+inline jstring NewString(const std::string &utf) {
+    auto *string = New<_jstring>(Class("java/lang/String"));
+    string->utf = utf;
+    string->chars.assign(utf.begin(), utf.end());
+    return string;
+}
+
+}  // namespace fakejni
+
+struct _JavaVM {
+    jint GetEnv(void **, jint) { return JNI_ERR; }
+    jint AttachCurrentThread(struct _JNIEnv **, void *) { return JNI_ERR; }
+    jint DetachCurrentThread() { return JNI_ERR; }
+};
+typedef _JavaVM JavaVM;
+
+#define FAKEJNI_PRIMITIVES(X)                                                                      \
+    X(Boolean, jboolean, jbooleanArray, _jbooleanArray)                                            \
+    X(Byte, jbyte, jbyteArray, _jbyteArray)                                                        \
+    X(Char, jchar, jcharArray, _jcharArray)                                                        \
+    X(Short, jshort, jshortArray, _jshortArray)                                                    \
+    X(Int, jint, jintArray, _jintArray)                                                            \
+    X(Long, jlong, jlongArray, _jlongArray)                                                        \
+    X(Float, jfloat, jfloatArray, _jfloatArray)                                                    \
+    X(Double, jdouble, jdoubleArray, _jdoubleArray)
+
+#define FAKEJNI_CALLS(Type, jtype)                                                                 \
+    jtype Call##Type##Method(jobject, jmethodID, ...) { return jtype{}; }                          \
+    jtype Call##Type##MethodV(jobject, jmethodID, va_list) { return jtype{}; }                     \
+    jtype Call##Type##MethodA(jobject, jmethodID, const jvalue *) { return jtype{}; }              \
+    jtype CallNonvirtual##Type##Method(jobject, jclass, jmethodID, ...) { return jtype{}; }        \
+    jtype CallNonvirtual##Type##MethodA(jobject, jclass, jmethodID, const jvalue *) {              \
+        return jtype{};                                                                            \
+    }                                                                                              \
+    jtype CallStatic##Type##Method(jclass, jmethodID, ...) { return jtype{}; }                     \
+    jtype CallStatic##Type##MethodA(jclass, jmethodID, const jvalue *) { return jtype{}; }
+
+#define FAKEJNI_PRIMITIVE_MEMBERS(Type, jtype, jarray_type, jarray_class)                          \
+    FAKEJNI_CALLS(Type, jtype)                                                                     \
+    jtype Get##Type##Field(jobject, jfieldID) { return jtype{}; }                                  \
+    void Set##Type##Field(jobject, jfieldID, jtype) {}                                             \
+    jtype GetStatic##Type##Field(jclass, jfieldID) { return jtype{}; }                             \
+    void SetStatic##Type##Field(jclass, jfieldID, jtype) {}                                        \
+    jarray_type New##Type##Array(jsize length) {                                                   \
+        auto *array = fakejni::New<jarray_class>(fakejni::Class("[" #Type));                       \
+        array->values.resize(length);                                                              \
+        return array;                                                                              \
+    }                                                                                              \
+    void Get##Type##ArrayRegion(jarray_type array, jsize start, jsize length, jtype *buffer) {     \
+        for (jsize i = 0; i < length; ++i) buffer[i] = static_cast<jtype>(array->values[start + i]); \
+    }                                                                                              \
+    void Set##Type##ArrayRegion(jarray_type array, jsize start, jsize length,                      \
+                                const jtype *buffer) {                                             \
+        for (jsize i = 0; i < length; ++i) {                                                       \
+            array->values[start + i] = static_cast<int64_t>(buffer[i]);                            \
+        }                                                                                          \
+    }
+
+struct _JNIEnv {
+    jint GetVersion() { return JNI_VERSION_1_6; }
+    jint GetJavaVM(JavaVM **) { return JNI_ERR; }
+
+    jclass FindClass(const char *name) {
+        return static_cast<jclass>(fakejni::Retain(fakejni::Class(name)));
+    }
+    jclass GetSuperclass(jclass) { return nullptr; }
+    jboolean IsAssignableFrom(jclass from, jclass to) { return from == to; }
+    jclass GetObjectClass(jobject object) {
+        return static_cast<jclass>(fakejni::Retain(object->klass));
+    }
+    jboolean IsInstanceOf(jobject object, jclass cls) {
+        return object && (object->klass == cls || cls->name == "java/lang/Object");
+    }
+
+    jmethodID GetMethodID(jclass cls, const char *name, const char *signature) {
+        return fakejni::Member<_jmethodID>(cls, name, signature);
+    }
+    jmethodID GetStaticMethodID(jclass cls, const char *name, const char *signature) {
+        return fakejni::Member<_jmethodID>(cls, name, signature);
+    }
+    jfieldID GetFieldID(jclass cls, const char *name, const char *signature) {
+        return fakejni::Member<_jfieldID>(cls, name, signature);
+    }
+    jfieldID GetStaticFieldID(jclass cls, const char *name, const char *signature) {
+        return fakejni::Member<_jfieldID>(cls, name, signature);
+    }
+    jmethodID FromReflectedMethod(jobject method) { return method ? method->method : nullptr; }
+    jfieldID FromReflectedField(jobject) { return nullptr; }
+    jobject ToReflectedMethod(jclass, jmethodID id, jboolean) {
+        auto *method = fakejni::New(fakejni::Class("java/lang/reflect/Method"));
+        method->method = id;
+        return method;
+    }
+
+    jint Throw(jthrowable) { return JNI_OK; }
+    jint ThrowNew(jclass, const char *) { return JNI_OK; }
+    jthrowable ExceptionOccurred() { return nullptr; }
+    void ExceptionDescribe() {}
+    void ExceptionClear() {}
+    jboolean ExceptionCheck() { return JNI_FALSE; }
+    void FatalError(const char *) { std::abort(); }
+
+    jint PushLocalFrame(jint) { return JNI_OK; }
+    jobject PopLocalFrame(jobject result) { return result; }
+    jint EnsureLocalCapacity(jint) { return JNI_OK; }
+    jobject NewGlobalRef(jobject object) { return fakejni::Retain(object); }
+    void DeleteGlobalRef(jobject object) { fakejni::Release(object); }
+    jobject NewLocalRef(jobject object) { return fakejni::Retain(object); }
+    void DeleteLocalRef(jobject object) { fakejni::Release(object); }
+    jweak NewWeakGlobalRef(jobject object) { return fakejni::Retain(object); }
+    void DeleteWeakGlobalRef(jweak object) { fakejni::Release(object); }
+    jboolean IsSameObject(jobject a, jobject b) { return a == b; }
+    jobjectRefType GetObjectRefType(jobject) { return JNIGlobalRefType; }
+
+    jobject AllocObject(jclass cls) { return fakejni::New(cls); }
+    jobject NewObject(jclass cls, jmethodID, ...) { return fakejni::New(cls); }
+    jobject NewObjectA(jclass cls, jmethodID, const jvalue *) { return fakejni::New(cls); }
+
+    jstring NewStringUTF(const char *utf) { return fakejni::NewString(utf); }
+    jsize GetStringLength(jstring string) { return static_cast<jsize>(string->chars.size()); }
+    jsize GetStringUTFLength(jstring string) { return static_cast<jsize>(string->utf.size()); }
+    const char *GetStringUTFChars(jstring string, jboolean *copy) {
+        if (copy) *copy = JNI_FALSE;
+        return string->utf.c_str();
+    }
+    void ReleaseStringUTFChars(jstring, const char *) {}
+    void GetStringRegion(jstring string, jsize start, jsize length, jchar *buffer) {
+        for (jsize i = 0; i < length; ++i) buffer[i] = string->chars[start + i];
+    }
+    const jchar *GetStringCritical(jstring string, jboolean *copy) {
+        if (copy) *copy = JNI_FALSE;
+        return reinterpret_cast<const jchar *>(string->chars.data());
+    }
+    void ReleaseStringCritical(jstring, const jchar *) {}
+
+    jsize GetArrayLength(jarray array) {
+        return static_cast<jsize>(array->elements.empty() ? array->values.size()
+                                                          : array->elements.size());
+    }
+    jobjectArray NewObjectArray(jsize length, jclass element_class, jobject initial) {
+        auto *array =
+            fakejni::New<_jobjectArray>(fakejni::Class("[L" + element_class->name + ";"));
+        array->elements.resize(length);
+        for (auto &element : array->elements) element = fakejni::Retain(initial);
+        return array;
+    }
+    jobject GetObjectArrayElement(jobjectArray array, jsize index) {
+        return fakejni::Retain(array->elements[index]);
+    }
+    void SetObjectArrayElement(jobjectArray array, jsize index, jobject value) {
+        fakejni::Release(std::exchange(array->elements[index], fakejni::Retain(value)));
+    }
+
+    jint MonitorEnter(jobject object) {
+        object->monitor.lock();
+        return JNI_OK;
+    }
+    jint MonitorExit(jobject object) {
+        object->monitor.unlock();
+        return JNI_OK;
+    }
+
+    jint RegisterNatives(jclass, const JNINativeMethod *, jint) { return JNI_OK; }
+
+    jobject GetObjectField(jobject, jfieldID) { return nullptr; }
+    void SetObjectField(jobject, jfieldID, jobject) {}
+    jobject GetStaticObjectField(jclass, jfieldID field) {
+        static std::mutex lock;
+        std::lock_guard lk(lock);
+        if (!field->static_value) field->static_value = fakejni::Class(field->name + ".static");
+        return fakejni::Retain(field->static_value);
+    }
+    void SetStaticObjectField(jclass, jfieldID, jobject) {}
+
+    FAKEJNI_CALLS(Object, jobject)
+    FAKEJNI_PRIMITIVES(FAKEJNI_PRIMITIVE_MEMBERS)
+
+    void CallVoidMethod(jobject, jmethodID, ...) {}
+    void CallVoidMethodV(jobject, jmethodID, va_list) {}
+    void CallVoidMethodA(jobject, jmethodID, const jvalue *) {}
+    void CallNonvirtualVoidMethod(jobject, jclass, jmethodID, ...) {}
+    void CallNonvirtualVoidMethodA(jobject, jclass, jmethodID, const jvalue *) {}
+    void CallStaticVoidMethod(jclass, jmethodID, ...) {}
+    void CallStaticVoidMethodA(jclass, jmethodID, const jvalue *) {}
+};
+typedef _JNIEnv JNIEnv;
+
+#undef FAKEJNI_PRIMITIVE_MEMBERS
+#undef FAKEJNI_CALLS
@@ -0,0 +1,46 @@
+#pragma once
+
+/**
+ * @file lsplant.hpp
+ * @brief lsplant as far as the hook bridge calls it, without touching any method.
+ *
+ * Hook hands back a fresh reflected method as the backup, which is all the bridge needs of it;
+ * nothing is patched, so a "hooked" method is only hooked in the registry.
+ */
+
+#include <jni.h>
+
+#include <functional>
+#include <string_view>
+
+#include "utils/jni_helper.hpp"
+
+namespace lsplant {
+
+struct InitInfo {
+    std::function<void *(void *, void *)> inline_hooker;
+    std::function<bool(void *)> inline_unhooker;
+    std::function<void *(std::string_view)> art_symbol_resolver;
+    std::function<void *(std::string_view)> art_symbol_prefix_resolver;
+    std::string_view generated_class_name = "LSPHooker_";
+    std::string_view generated_source_name = "LSP";
+    std::string_view generated_field_name = "hooker";
+    std::string_view generated_method_name = "{target}";
+};
+
+inline bool Init(JNIEnv *, const InitInfo &) { return true; }
+
+/// The backup of [target]: a reflected method of its own, as a reference lsplant keeps.
+inline jobject Hook(JNIEnv *, jobject target, jobject, jobject) {
+    return target ? fakejni::NewMethod(target->method ? target->method->name + "$backup" : "")
+                  : nullptr;
+}
+
+inline bool UnHook(JNIEnv *, jobject) { return true; }
+inline bool IsHooked(JNIEnv *, jobject) { return false; }
+inline bool Deoptimize(JNIEnv *, jobject) { return true; }
+inline void *GetNativeFunction(JNIEnv *, jobject) { return nullptr; }
+inline bool MakeClassInheritable(JNIEnv *, jclass) { return true; }
+inline bool MakeDexFileTrusted(JNIEnv *, jobject) { return true; }
+
+}  // namespace lsplant
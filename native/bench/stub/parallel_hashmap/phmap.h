@@ -0,0 +1,126 @@
+#pragma once
+
+/**
+ * @file phmap.h
+ * @brief phmap's parallel_flat_hash_map, reduced to the calls the hook bridge makes.
+ *
+ * Like the real one it is 2^N submaps, each behind its own mutex and picked by the key's hash,
+ * so the locking a caller pays for is the same; only the table inside a submap differs.
+ */
+
+#include <array>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace phmap {
+namespace priv {
+template <class K>
+using hash_default_hash = std::hash<K>;
+template <class K>
+using hash_default_eq = std::equal_to<K>;
+template <class A, class B>
+using Pair = std::pair<A, B>;
+template <class T>
+using Allocator = std::allocator<T>;
+}  // namespace priv
+
+template <class K, class V, class Hash, class Eq, class Alloc, size_t N, class Mutex>
+class parallel_flat_hash_map {
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+
+    /// Calls [f] with the entry of [key] under a reader lock, if there is one.
+    template <class F>
+    bool if_contains(const K &key, F &&f) const {
+        const auto &sub = Submap(key);
+        std::shared_lock lock(sub.mutex);
+        auto it = sub.map.find(key);
+        if (it == sub.map.end()) return false;
+        f(*it);
+        return true;
+    }
+
+    /// Calls [found] with the existing entry of [key], or [make] with a constructor for a new one.
+    template <class F1, class F2>
+    bool lazy_emplace_l(const K &key, F1 &&found, F2 &&make) {
+        auto &sub = Submap(key);
+        std::unique_lock lock(sub.mutex);
+        auto it = sub.map.find(key);
+        if (it != sub.map.end()) {
+            found(*it);
+            return false;
+        }
+        make([&sub](auto &&k, auto &&v) {
+            sub.map.emplace(std::forward<decltype(k)>(k), std::forward<decltype(v)>(v));
+        });
+        return true;
+    }
+
+    template <class F>
+    bool modify_if(const K &key, F &&f) {
+        auto &sub = Submap(key);
+        std::unique_lock lock(sub.mutex);
+        auto it = sub.map.find(key);
+        if (it == sub.map.end()) return false;
+        f(*it);
+        return true;
+    }
+
+    template <class F>
+    bool erase_if(const K &key, F &&f) {
+        auto &sub = Submap(key);
+        std::unique_lock lock(sub.mutex);
+        auto it = sub.map.find(key);
+        if (it == sub.map.end() || !f(*it)) return false;
+        sub.map.erase(it);
+        return true;
+    }
+
+    template <class F>
+    void for_each(F &&f) const {
+        for (const auto &sub : submaps_) {
+            std::shared_lock lock(sub.mutex);
+            for (const auto &entry : sub.map) f(entry);
+        }
+    }
+
+    template <class F>
+    void for_each_m(F &&f) {
+        for (auto &sub : submaps_) {
+            std::unique_lock lock(sub.mutex);
+            for (auto &entry : sub.map) f(entry);
+        }
+    }
+
+    size_t size() const {
+        size_t size = 0;
+        for (const auto &sub : submaps_) {
+            std::shared_lock lock(sub.mutex);
+            size += sub.map.size();
+        }
+        return size;
+    }
+
+private:
+    struct alignas(64) Inner {
+        mutable Mutex mutex;
+        std::unordered_map<K, V, Hash, Eq> map;
+    };
+
+    Inner &Submap(const K &key) { return submaps_[Index(key)]; }
+    const Inner &Submap(const K &key) const { return submaps_[Index(key)]; }
+    static size_t Index(const K &key) {
+        // Mixed first: std::hash of a pointer is the pointer, whose low bits are alignment.
+        size_t h = Hash{}(key) * 0x9E3779B97F4A7C15ull;
+        return (h >> 32) & ((size_t{1} << N) - 1);
+    }
+
+    std::array<Inner, size_t{1} << N> submaps_;
+};
+}  // namespace phmap
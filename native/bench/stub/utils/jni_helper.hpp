@@ -0,0 +1,97 @@
+#pragma once
+
+/**
+ * @file jni_helper.hpp
+ * @brief The part of lsplant's JNI helpers the hook bridge and its headers use, over the stub JNI.
+ */
+
+#include <jni.h>
+
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace lsplant {
+
+template <typename T>
+class ScopedLocalRef {
+public:
+    using BaseType = T;
+
+    ScopedLocalRef(JNIEnv *env, T value) : env_(env), value_(value) {}
+    explicit ScopedLocalRef(JNIEnv *env) : env_(env), value_(nullptr) {}
+    ScopedLocalRef(ScopedLocalRef &&other) : env_(other.env_), value_(other.release()) {}
+    ScopedLocalRef(const ScopedLocalRef &) = delete;
+    ScopedLocalRef &operator=(const ScopedLocalRef &) = delete;
+    ~ScopedLocalRef() { reset(); }
+
+    T get() const { return value_; }
+    T release() { return std::exchange(value_, nullptr); }
+    void reset(T value = nullptr) {
+        if (value_) env_->DeleteLocalRef(value_);
+        value_ = value;
+    }
+    JNIEnv *env() const { return env_; }
+    explicit operator bool() const { return value_ != nullptr; }
+
+private:
+    JNIEnv *env_;
+    T value_;
+};
+
+class JNIMonitor {
+public:
+    JNIMonitor(JNIEnv *env, jobject object) : env_(env), object_(object) {
+        env_->MonitorEnter(object_);
+    }
+    ~JNIMonitor() { env_->MonitorExit(object_); }
+    JNIMonitor(const JNIMonitor &) = delete;
+    JNIMonitor &operator=(const JNIMonitor &) = delete;
+
+private:
+    JNIEnv *env_;
+    jobject object_;
+};
+
+class JUTFString {
+public:
+    JUTFString(JNIEnv *env, jstring string, const char *fallback = nullptr)
+        : chars_(string ? env->GetStringUTFChars(string, nullptr) : fallback) {}
+    const char *get() const { return chars_; }
+    operator const char *() const { return chars_; }
+    operator std::string() const { return chars_ ? chars_ : ""; }
+
+private:
+    const char *chars_;
+};
+
+template <typename T>
+struct IsScopedLocalRef : std::false_type {};
+template <typename T>
+struct IsScopedLocalRef<ScopedLocalRef<T>> : std::true_type {};
+
+template <typename T>
+decltype(auto) UnwrapScope(T &&value) {
+    if constexpr (IsScopedLocalRef<std::remove_cvref_t<T>>::value) {
+        return value.get();
+    } else {
+        return std::forward<T>(value);
+    }
+}
+
+template <typename C>
+jmethodID JNI_GetStaticMethodID(JNIEnv *env, C &&cls, std::string_view name,
+                                std::string_view signature) {
+    return env->GetStaticMethodID(UnwrapScope(cls), std::string(name).c_str(),
+                                  std::string(signature).c_str());
+}
+
+template <typename C>
+jint JNI_RegisterNatives(JNIEnv *env, C &&cls, const JNINativeMethod *methods, jint count) {
+    return env->RegisterNatives(UnwrapScope(cls), methods, count);
+}
+
+inline ScopedLocalRef<jthrowable> ClearException(JNIEnv *env) { return {env, nullptr}; }
+
+}  // namespace lsplant
@@ -73,6 +73,24 @@ public:
         return FindClassFromLoader(env, GetCurrentClassLoader(), class_name);
     }
 
+    /**
+     * @brief Resolves a list of classes from one class loader.
+     *
+     * Names a loader has reported missing are remembered for as long as the loader lives and not
+     * asked for again, so probing for optional classes on every load costs a set lookup rather
+     * than a loadClass call and a ClassNotFoundException. They are forgotten once a path is added
+     * to the loader or one of its ancestors. Misses are only remembered where the loader and its
+     * ancestors are BaseDexClassLoaders all the way up to the boot class loader.
+     *
+     * @param env The JNI environment.
+     * @param class_loader The class loader to use for the lookup, or null for the boot class path,
+     *                     as for Class.forName.
+     * @param class_names A String[] of binary class names (dot-separated).
+     * @return A Class[] of the same length, null where a class is not found.
+     */
+    static jobjectArray FindClassesFromLoader(JNIEnv *env, jobject class_loader,
+                                              jobjectArray class_names);
+
     virtual ~Context() = default;
 
 protected:
@@ -1,5 +1,10 @@
 #include "core/context.h"
 
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
 #include "core/config_bridge.h"
 #include "jni/jni_hooks.h"
 
@@ -136,4 +141,176 @@ lsplant::ScopedLocalRef<jclass> Context::FindClassFromLoader(JNIEnv *env, jobjec
     return {env, nullptr};
 }
 
+namespace {
+
+/**
+ * @brief The class names one loader has reported missing.
+ *
+ * The loader is held weakly so that remembering its misses does not keep it alive; entries whose
+ * loader has been collected are dropped on the next lookup. [paths] are the dexElements arrays the
+ * loader and its ancestors searched when the names were missed. DexPathList swaps in a new array
+ * whenever it gains a path, through BaseDexClassLoader.addDexPath for one, so an entry whose arrays
+ * are not the current ones any more forgets its names before it answers.
+ */
+struct AbsentClasses {
+    jweak loader;
+    std::vector<jweak> paths;
+    std::unordered_set<std::string> names;
+};
+
+std::mutex absent_classes_lock;
+std::vector<AbsentClasses> absent_classes;
+// Names missing from the boot class path, which a null loader stands for and which never grows.
+std::unordered_set<std::string> absent_boot_classes;
+
+using LocalRefs = std::vector<lsplant::ScopedLocalRef<jobject>>;
+
+/**
+ * @brief Appends the dexElements arrays [class_loader] and its ancestors search to [paths], up to
+ * the boot class loader.
+ *
+ * @return false when a loader on the way is neither a BaseDexClassLoader nor the boot class loader:
+ *         it may find classes in ways that cannot be watched, so its misses are not remembered.
+ */
+bool PathsOf(JNIEnv *env, jobject class_loader, LocalRefs &paths) {
+    static const auto boot_class_loader_class =
+        lsplant::JNI_NewGlobalRef(env, lsplant::JNI_FindClass(env, "java/lang/BootClassLoader"));
+    static const auto base_dex_class_loader_class = lsplant::JNI_NewGlobalRef(
+        env, lsplant::JNI_FindClass(env, "dalvik/system/BaseDexClassLoader"));
+    static const auto path_list_class =
+        lsplant::JNI_NewGlobalRef(env, lsplant::JNI_FindClass(env, "dalvik/system/DexPathList"));
+    static const auto class_loader_class =
+        lsplant::JNI_NewGlobalRef(env, lsplant::JNI_FindClass(env, "java/lang/ClassLoader"));
+    static jfieldID path_list_fid = env->GetFieldID(base_dex_class_loader_class, "pathList",
+                                                    "Ldalvik/system/DexPathList;");
+    static jfieldID dex_elements_fid = env->GetFieldID(path_list_class, "dexElements",
+                                                       "[Ldalvik/system/DexPathList$Element;");
+    static jmethodID get_parent_mid =
+        env->GetMethodID(class_loader_class, "getParent", "()Ljava/lang/ClassLoader;");
+    if (!boot_class_loader_class || !path_list_fid || !dex_elements_fid || !get_parent_mid) {
+        env->ExceptionClear();
+        return false;
+    }
+
+    lsplant::ScopedLocalRef<jobject> loader(env, env->NewLocalRef(class_loader));
+    while (!env->IsInstanceOf(loader.get(), boot_class_loader_class)) {
+        if (!env->IsInstanceOf(loader.get(), base_dex_class_loader_class)) return false;
+        lsplant::ScopedLocalRef<jobject> path_list(env, env->GetObjectField(loader.get(),
+                                                                            path_list_fid));
+        if (!path_list) return false;
+        paths.emplace_back(env, env->GetObjectField(path_list.get(), dex_elements_fid));
+
+        lsplant::ScopedLocalRef<jobject> parent(env, env->CallObjectMethod(loader.get(),
+                                                                           get_parent_mid));
+        if (env->ExceptionCheck()) {
+            env->ExceptionClear();
+            return false;
+        }
+        if (!parent) return false;
+        loader = std::move(parent);
+    }
+    return true;
+}
+
+/**
+ * @brief The names known to be missing from [class_loader] while it searches [paths], created on
+ * first use and emptied when [paths] are not the arrays they were. Callers hold absent_classes_lock.
+ */
+std::unordered_set<std::string> *AbsentClassesOf(JNIEnv *env, jobject class_loader,
+                                                 const LocalRefs &paths) {
+    AbsentClasses *found = nullptr;
+    for (auto it = absent_classes.begin(); it != absent_classes.end();) {
+        if (env->IsSameObject(it->loader, nullptr)) {
+            env->DeleteWeakGlobalRef(it->loader);
+            for (auto path : it->paths) env->DeleteWeakGlobalRef(path);
+            it = absent_classes.erase(it);
+            continue;
+        }
+        if (!found && env->IsSameObject(it->loader, class_loader)) {
+            found = &*it;
+        }
+        ++it;
+    }
+    if (!found) {
+        found = &absent_classes.emplace_back(
+            AbsentClasses{env->NewWeakGlobalRef(class_loader), {}, {}});
+    }
+
+    bool current = found->paths.size() == paths.size();
+    for (size_t i = 0; current && i < paths.size(); ++i) {
+        current = env->IsSameObject(found->paths[i], paths[i].get());
+    }
+    if (!current) {
+        found->names.clear();
+        for (auto path : found->paths) env->DeleteWeakGlobalRef(path);
+        found->paths.clear();
+        for (const auto &path : paths) found->paths.push_back(env->NewWeakGlobalRef(path.get()));
+    }
+    return &found->names;
+}
+
+}  // namespace
+
+jobjectArray Context::FindClassesFromLoader(JNIEnv *env, jobject class_loader,
+                                            jobjectArray class_names) {
+    static const auto class_class =
+        lsplant::JNI_NewGlobalRef(env, lsplant::JNI_FindClass(env, "java/lang/Class"));
+    static const auto class_loader_class =
+        lsplant::JNI_NewGlobalRef(env, lsplant::JNI_FindClass(env, "java/lang/ClassLoader"));
+    static const auto not_found_class = lsplant::JNI_NewGlobalRef(
+        env, lsplant::JNI_FindClass(env, "java/lang/ClassNotFoundException"));
+    static jmethodID load_class_mid = lsplant::JNI_GetMethodID(
+        env, class_loader_class, "loadClass", "(Ljava/lang/String;)Ljava/lang/Class;");
+    static jmethodID for_name_mid =
+        env->GetStaticMethodID(class_class, "forName",
+                               "(Ljava/lang/String;ZLjava/lang/ClassLoader;)Ljava/lang/Class;");
+
+    const jsize count = class_names ? env->GetArrayLength(class_names) : 0;
+    auto result = env->NewObjectArray(count, class_class, nullptr);
+    if (!result || !load_class_mid || !for_name_mid) return result;
+
+    // Looked up once for the whole list: a path added while it is being loaded is caught next time.
+    LocalRefs paths;
+    const bool remembered = !class_loader || PathsOf(env, class_loader, paths);
+    auto absent = [&]() -> std::unordered_set<std::string> * {
+        if (!remembered) return nullptr;
+        return class_loader ? AbsentClassesOf(env, class_loader, paths) : &absent_boot_classes;
+    };
+
+    for (jsize i = 0; i < count; ++i) {
+        auto name = static_cast<jstring>(env->GetObjectArrayElement(class_names, i));
+        if (!name) continue;
+        std::string class_name = lsplant::JUTFString(env, name);
+        {
+            std::lock_guard lk(absent_classes_lock);
+            if (auto *names = absent(); names && names->contains(class_name)) {
+                env->DeleteLocalRef(name);
+                continue;
+            }
+        }
+
+        // A null loader means the boot class path, as it does for Class.forName, which is the only
+        // way to reach it: there is no boot class loader object to call loadClass on.
+        auto loaded = class_loader
+                          ? env->CallObjectMethod(class_loader, load_class_mid, name)
+                          : env->CallStaticObjectMethod(class_class, for_name_mid, name, JNI_FALSE,
+                                                        nullptr);
+        env->DeleteLocalRef(name);
+        if (auto exception = env->ExceptionOccurred()) {
+            env->ExceptionClear();
+            // Only a plain miss is remembered. A class that exists but fails to link, or a loader
+            // that failed for some other reason, may well succeed when asked again.
+            if (env->IsInstanceOf(exception, not_found_class)) {
+                std::lock_guard lk(absent_classes_lock);
+                if (auto *names = absent()) names->insert(std::move(class_name));
+            }
+            env->DeleteLocalRef(exception);
+            continue;
+        }
+        env->SetObjectArrayElement(result, i, loaded);
+        env->DeleteLocalRef(loaded);
+    }
+    return result;
+}
+
 }  // namespace vector::native
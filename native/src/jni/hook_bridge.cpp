@@ -1,13 +1,21 @@
 #include <alloca.h>
+#include <android/api-level.h>
 #include <parallel_hashmap/phmap.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
 #include <unistd.h>
 
 #include <algorithm>
+#include <bit>
+#include <cstring>
 #include <lsplant.hpp>
 #include <limits>
 #include <memory>
+#include <mutex>
+#include <new>
 #include <shared_mutex>
+#include <span>
+#include <string>
 #include <vector>
 
 #include "core/config_bridge.h"
@@ -16,80 +24,2862 @@
 
 namespace {
 
+/**
+ * @class EpochDomain
+ * @brief Epoch-based reclamation for state that hooked calls read without taking a lock.
+ *
+ * A reader announces the epoch it entered in, in a slot of its own, and clears it on the way out.
+ * A writer unlinks what it replaces, advances the epoch and parks the old object, which is freed
+ * once every reader still inside entered after it was parked: none of them can be holding it.
+ *
+ * The slot is a thread_local registered on first use, so entering costs a store and a fence, and
+ * neither shares a cache line with any other thread. Retiring and scanning are for writers only,
+ * which are rare and already on a slow path.
+ */
+class EpochDomain {
+    static constexpr uint64_t kIdle = std::numeric_limits<uint64_t>::max();
+
+    struct Slot {
+        std::atomic<uint64_t> epoch{kIdle};
+        Slot() { Instance().Register(this); }
+        ~Slot() { Instance().Unregister(this); }
+    };
+
+public:
+    /// Scoped read-side critical section. Nests: only the outermost guard on a thread counts.
+    class Guard {
+    public:
+        Guard() : slot_(LocalSlot()) {
+            outermost_ = slot_.epoch.load(std::memory_order_relaxed) == kIdle;
+            if (!outermost_) return;
+            slot_.epoch.store(Instance().epoch_.load(std::memory_order_relaxed),
+                              std::memory_order_relaxed);
+            // Pairs with the fence in Collect: either the writer sees this slot, or every load
+            // below sees what the writer published before it scanned.
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+        ~Guard() {
+            if (outermost_) slot_.epoch.store(kIdle, std::memory_order_release);
+        }
+
+        Guard(const Guard &) = delete;
+        Guard &operator=(const Guard &) = delete;
+
+    private:
+        Slot &slot_;
+        bool outermost_;
+    };
+
+    using Deleter = void (*)(JNIEnv *, void *);
+
+    static EpochDomain &Instance() {
+        static EpochDomain domain;
+        return domain;
+    }
+
+    /**
+     * @brief Parks an object that readers can no longer reach, and frees whatever is now safe to.
+     * The caller must already have unpublished [ptr].
+     */
+    void Retire(JNIEnv *env, void *ptr, Deleter deleter) {
+        if (ptr == nullptr) return;
+        {
+            std::lock_guard lk(retired_lock_);
+            retired_.push_back({epoch_.fetch_add(1, std::memory_order_seq_cst), ptr, deleter});
+        }
+        Collect(env);
+    }
+
+private:
+    struct Retired {
+        uint64_t epoch;
+        void *ptr;
+        Deleter deleter;
+    };
+
+    static Slot &LocalSlot() {
+        thread_local Slot slot;
+        return slot;
+    }
+
+    void Register(Slot *slot) {
+        std::lock_guard lk(slots_lock_);
+        slots_.push_back(slot);
+    }
+
+    void Unregister(Slot *slot) {
+        std::lock_guard lk(slots_lock_);
+        std::erase(slots_, slot);
+    }
+
+    void Collect(JNIEnv *env) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t oldest = kIdle;
+        {
+            std::lock_guard lk(slots_lock_);
+            for (const auto *slot : slots_) {
+                oldest = std::min(oldest, slot->epoch.load(std::memory_order_acquire));
+            }
+        }
+        std::vector<Retired> ready;
+        {
+            std::lock_guard lk(retired_lock_);
+            auto split = std::partition(retired_.begin(), retired_.end(),
+                                        [oldest](const auto &r) { return r.epoch >= oldest; });
+            ready.assign(split, retired_.end());
+            retired_.erase(split, retired_.end());
+        }
+        // Outside the lock: a deleter may call into the runtime.
+        for (const auto &r : ready) r.deleter(env, r.ptr);
+    }
+
+    std::atomic<uint64_t> epoch_{0};
+    std::mutex slots_lock_;
+    std::vector<Slot *> slots_;
+    std::mutex retired_lock_;
+    std::vector<Retired> retired_;
+};
+
+/**
+ * @struct CallbackFilter
+ * @brief A predicate on a hooked call's arguments that decides whether a callback sees the call.
+ *
+ * All clauses must hold. Filters are evaluated natively when the hooker asks for its snapshot, so
+ * a call no callback wants goes straight to the original without the Java chain being set up. The
+ * boxing of the arguments and the call into the hooker have already happened by then: lsplant's
+ * trampoline makes both before any native code of ours runs.
+ *
+ * Immutable once built. Replacing or removing one retires it through the epoch domain, since a
+ * snapshot being evaluated may still point at it.
+ */
+struct CallbackFilter {
+    // Shared with HookBridge.setCallbackFilter.
+    enum Kind : jint {
+        kArgIsNull = 0,
+        kArgInstanceOf = 1,
+        kArgEqualsInt = 2,
+        kArgEqualsString = 3,
+        kThisInstanceOf = 4,
+    };
+
+    struct Clause {
+        Kind kind;
+        jint index;              // Parameter index, not counting the receiver.
+        jint int_value;          // kArgEqualsInt.
+        jobject constant;        // Global reference: the class, or the string for kArgEqualsString.
+        std::u16string string;   // kArgEqualsString, decoded once.
+    };
+
+    std::vector<Clause> clauses;
+
+    /// Whether a call with receiver [thiz] and parameters from [args][first_arg] on passes.
+    bool Matches(JNIEnv *env, jobject thiz, jobjectArray args, jsize first_arg) const;
+
+    static void Delete(JNIEnv *env, void *ptr) {
+        auto *filter = static_cast<CallbackFilter *>(ptr);
+        for (const auto &clause : filter->clauses) {
+            if (clause.constant) env->DeleteGlobalRef(clause.constant);
+        }
+        delete filter;
+    }
+};
+
+/**
+ * @struct CallbackSampler
+ * @brief Lets a callback see only a sample of the calls its filter accepts, decided before the
+ * Java dispatch, so that a call left out of the sample costs about what a filtered one does.
+ *
+ * kEveryNth counts on one counter for all threads, so exactly every Nth call is taken. kProbability
+ * draws from a per-thread xorshift generator and touches nothing shared. kPerSecond counts calls
+ * in the current second of the coarse monotonic clock, second and count packed into one word so
+ * that no second lets more than its budget through.
+ *
+ * Owned by its callback entry and retired like a CallbackFilter; its counter is the only thing
+ * about it that changes.
+ */
+struct CallbackSampler {
+    // Shared with VectorHookSampling.
+    enum Kind : jint {
+        kEveryNth = 1,
+        kProbability = 2,
+        kPerSecond = 3,
+    };
+
+    Kind kind;
+    uint64_t value;  // N; the chance out of 2^32; the calls allowed per second.
+    mutable std::atomic<uint64_t> state{0};
+
+    /// Whether a call the filter accepted is in the sample.
+    bool Take() const {
+        switch (kind) {
+        case kEveryNth:
+            return state.fetch_add(1, std::memory_order_relaxed) % value == 0;
+        case kProbability: {
+            thread_local uint64_t random =
+                (static_cast<uint64_t>(gettid()) * 0x9E3779B97F4A7C15ULL) | 1;
+            random ^= random << 13;
+            random ^= random >> 7;
+            random ^= random << 17;
+            return (random >> 32) < value;
+        }
+        case kPerSecond: {
+            timespec now;
+            clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+            const auto second = static_cast<uint32_t>(now.tv_sec);
+            auto current = state.load(std::memory_order_relaxed);
+            for (;;) {
+                uint64_t next;
+                if (current >> 32 != second) {
+                    next = static_cast<uint64_t>(second) << 32 | 1;
+                } else if ((current & 0xffffffffULL) >= value) {
+                    return false;
+                } else {
+                    next = current + 1;
+                }
+                if (state.compare_exchange_weak(current, next, std::memory_order_relaxed)) {
+                    return true;
+                }
+            }
+        }
+        }
+        return true;
+    }
+
+    static void Delete(JNIEnv *, void *ptr) { delete static_cast<CallbackSampler *>(ptr); }
+};
+
+/**
+ * @struct ObserverSpec
+ * @brief Turns a registered callback into an observer: what it takes from each call, and where
+ * that goes.
+ *
+ * An observer never runs on the hooked thread. The call copies the values it captures into an
+ * ObserverQueue slot, and the observer thread hands them to [receiver]. Primitives go by value and
+ * cost nothing more. A captured reference must outlive the call, so it becomes a global reference,
+ * which takes ART's global reference lock on the hooked thread and again on the observer thread to
+ * delete it: capture only the references an observer needs. Nothing is taken before a slot is
+ * claimed, so a call dropped by a full queue pays for none of it.
+ *
+ * Immutable once built, and retired like a CallbackFilter. Queued captures count as references to
+ * it instead of holding [receiver] themselves, and the last of them frees it.
+ */
+struct ObserverSpec {
+    static constexpr size_t kMaxCaptures = 8;
+    // Shared with VectorObserver.RECEIVER: captures the receiver rather than a parameter.
+    static constexpr jint kReceiver = -1;
+
+    jobject receiver;            // Global reference to the Java side's delivery object.
+    jmethodID deliver;           // Its deliver(Object[]).
+    std::vector<jint> captures;  // Parameter indexes, not counting the receiver, or kReceiver.
+    std::string types;           // The shorty character of each capture.
+    // One for the callback entry that owns this, plus one per capture still in the queue.
+    mutable std::atomic<uint32_t> references{1};
+
+    /// Queues what this captures of a call with receiver [thiz] and parameters from
+    /// [args][first_arg] on. A full queue drops the call and counts it.
+    void Capture(JNIEnv *env, jobject thiz, jobjectArray args, jsize first_arg) const;
+
+    /// Drops one reference; the last one frees the spec.
+    void Release(JNIEnv *env) const {
+        if (references.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+        env->DeleteGlobalRef(receiver);
+        delete this;
+    }
+
+    static void Delete(JNIEnv *env, void *ptr) { static_cast<ObserverSpec *>(ptr)->Release(env); }
+};
+
+/**
+ * @struct CallbackSnapshot
+ * @brief An immutable, already ordered view of a HookItem's callbacks.
+ *
+ * [callbacks] is a global reference to the Object[2][] handed to Java: index 0 holds the modern
+ * callbacks and index 1 the legacy ones, both highest priority first. Java only ever reads it, so
+ * one array serves every call until the next change replaces it wholesale. Observers are not in it:
+ * the hooked call hands them what they capture and moves on.
+ */
+struct CallbackSnapshot {
+    jobjectArray callbacks;
+    jsize modern_count;
+    jsize legacy_count;
+    // The filter of every callback, modern ones first, null where a callback takes every call.
+    // Empty when none has a filter, which is what lets unfiltered hooks skip evaluation.
+    std::vector<const CallbackFilter *> filters;
+    // In the same order, the sampler of every callback, null where it takes every call it accepts.
+    // Empty when none samples.
+    std::vector<const CallbackSampler *> samplers;
+    // In the same order, whether a callback stays out of calls made while it is already running on
+    // the thread. Empty when none does, and then reentry is not tracked for the method at all.
+    std::vector<bool> skips_reentry;
+
+    struct Observer {
+        const CallbackFilter *filter;
+        const CallbackSampler *sampler;
+        const ObserverSpec *spec;
+    };
+    std::vector<Observer> observers;
+    // Every callback memoizes, so a call whose arguments were seen before is answered natively.
+    bool memoized = false;
+
+    static void Delete(JNIEnv *env, void *ptr) {
+        auto *snapshot = static_cast<CallbackSnapshot *>(ptr);
+        env->DeleteGlobalRef(snapshot->callbacks);
+        delete snapshot;
+    }
+};
+
+struct HookCell;
+class MemoTable;
+
+/**
+ * @brief The hooked methods whose Java dispatch is running on this thread, innermost last.
+ *
+ * Only methods with a callback that skips reentrant calls are pushed, so every other hook pays a
+ * thread-local load for this and nothing more. handleCallbackSnapshot pushes the entry and the
+ * hooker's handleRecordInvocation, which runs in a finally, pops it.
+ */
+thread_local std::vector<const HookCell *> dispatching;
+
+// Cached classes for building snapshots, resolved once at registration.
+jclass object_class = nullptr;
+jclass object_array_class = nullptr;
+// Object.toString, for naming traced methods.
+jmethodID to_string_method = nullptr;
+// For string clauses of argument filters, and memo keys, which hold strings by value.
+jclass string_class = nullptr;
+// System.identityHashCode, which memo keys hash other objects by.
+jclass system_class = nullptr;
+jmethodID identity_hash_code = nullptr;
+
+// How long a hook may sit with no callbacks before it is removed, in nanoseconds; negative keeps
+// idle hooks forever. Long enough to ride out a hot reload, which unhooks and then hooks again.
+std::atomic<int64_t> idle_hook_timeout{std::chrono::nanoseconds(std::chrono::seconds(10)).count()};
+// The number of hooks currently without callbacks, so that sweeping costs nothing when there are
+// none to sweep.
+std::atomic<size_t> idle_hooks{0};
+
+int64_t SteadyNow() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+}
+
+/**
+ * @struct HookStats
+ * @brief Invocation counters and a callback latency histogram for one hook.
+ *
+ * Sharded by thread, so that a hook hit from many threads at once does not bounce one cache line
+ * between them: recording is a handful of relaxed increments on a line the thread mostly has to
+ * itself. Readers sum the shards, and may see one call's counters half applied.
+ */
+struct HookStats {
+    static constexpr size_t kShards = 8;
+    // Bucket 0 counts calls under 2^kFirstBucketShift ns, bucket i those under twice the bound of
+    // bucket i - 1, and the last bucket everything longer.
+    static constexpr size_t kBuckets = 24;
+    static constexpr int kFirstBucketShift = 10;
+
+    struct alignas(64) Shard {
+        std::atomic<uint64_t> invocations{0};
+        std::atomic<uint64_t> callback_nanos{0};
+        std::atomic<uint64_t> max_callback_nanos{0};
+        std::atomic<uint64_t> original_nanos{0};
+        std::atomic<uint32_t> histogram[kBuckets]{};
+    };
+
+    struct Totals {
+        uint64_t invocations = 0;
+        uint64_t callback_nanos = 0;
+        uint64_t max_callback_nanos = 0;
+        uint64_t original_nanos = 0;
+        uint64_t histogram[kBuckets] = {};
+    };
+
+    Shard shards[kShards];
+
+    /// Records one hooked call that spent [callback] ns in callbacks and [original] ns in the
+    /// original.
+    void Record(uint64_t callback, uint64_t original) {
+        static std::atomic<size_t> next_shard{0};
+        static thread_local const size_t index =
+            next_shard.fetch_add(1, std::memory_order_relaxed) % kShards;
+        auto &shard = shards[index];
+
+        shard.invocations.fetch_add(1, std::memory_order_relaxed);
+        shard.callback_nanos.fetch_add(callback, std::memory_order_relaxed);
+        shard.original_nanos.fetch_add(original, std::memory_order_relaxed);
+        auto max = shard.max_callback_nanos.load(std::memory_order_relaxed);
+        while (callback > max && !shard.max_callback_nanos.compare_exchange_weak(
+                                     max, callback, std::memory_order_relaxed)) {
+        }
+        auto bucket = callback >> kFirstBucketShift == 0
+                          ? 0
+                          : std::min<size_t>(kBuckets - 1,
+                                             std::bit_width(callback) - kFirstBucketShift);
+        shard.histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Totals Sum() const {
+        Totals totals;
+        for (const auto &shard : shards) {
+            totals.invocations += shard.invocations.load(std::memory_order_relaxed);
+            totals.callback_nanos += shard.callback_nanos.load(std::memory_order_relaxed);
+            totals.max_callback_nanos =
+                std::max<uint64_t>(totals.max_callback_nanos,
+                                   shard.max_callback_nanos.load(std::memory_order_relaxed));
+            totals.original_nanos += shard.original_nanos.load(std::memory_order_relaxed);
+            for (size_t i = 0; i < kBuckets; ++i) {
+                totals.histogram[i] += shard.histogram[i].load(std::memory_order_relaxed);
+            }
+        }
+        return totals;
+    }
+};
+
+/**
+ * @struct CallbackOptions
+ * @brief What a callback has been set up with beyond its priority. Few callbacks have any of it,
+ * so it lives out of line and the entries of the rest stay at 24 bytes on 64-bit.
+ *
+ * Only writers touch it, under the monitor of the backup; a snapshot copies out what hooked calls
+ * need. The filter, observer and sampler are pointed at by snapshots, so they are retired through
+ * the epoch domain, while the options themselves can go at once.
+ */
+struct CallbackOptions {
+    const CallbackFilter *filter = nullptr;  // Owned; null takes every call.
+    bool skips_reentry = false;  // Left out of a call made while it is running on the thread.
+    const ObserverSpec *observer = nullptr;  // Owned; set for an observer.
+    const CallbackSampler *sampler = nullptr;  // Owned; null takes every call.
+    bool memoizes = false;  // Agrees to calls being answered from the hook's memo table.
+};
+
+/**
+ * @struct Callback
+ * @brief One registered callback, with its priority and the module it is attributed to.
+ */
+struct Callback {
+    jobject object;  // Global reference.
+    jint owner;      // Index into the owners GetOwnerId interns.
+    jint priority;
+    CallbackOptions *options = nullptr;  // Owned by the entry; null until one is set.
+
+    const CallbackFilter *filter() const { return options ? options->filter : nullptr; }
+    bool skips_reentry() const { return options && options->skips_reentry; }
+    const ObserverSpec *observer() const { return options ? options->observer : nullptr; }
+    const CallbackSampler *sampler() const { return options ? options->sampler : nullptr; }
+    bool memoizes() const { return options && options->memoizes; }
+
+    /// The options to change, made on first use. Callers hold the monitor of the backup.
+    CallbackOptions &Options() {
+        if (!options) options = new CallbackOptions;
+        return *options;
+    }
+};
+
+/**
+ * @class CallbackList
+ * @brief The callbacks of one kind on a hook, highest priority first, in one contiguous array.
+ *
+ * Nearly every hook carries one or two callbacks, so that many are stored inside the list itself
+ * and need no allocation; only a longer list moves to the heap. Equal priorities stay in the order
+ * they were registered in.
+ */
+class CallbackList {
+public:
+    static constexpr uint32_t kInline = 2;
+
+    CallbackList() = default;
+    CallbackList(const CallbackList &) = delete;
+    CallbackList &operator=(const CallbackList &) = delete;
+    ~CallbackList() {
+        if (data_ != inline_) delete[] data_;
+    }
+
+    Callback *begin() { return data_; }
+    Callback *end() { return data_ + size_; }
+    const Callback *begin() const { return data_; }
+    const Callback *end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    Callback &operator[](size_t index) { return data_[index]; }
+
+    /// Inserts [callback] behind every entry of the same or a higher priority.
+    /// @return The index it was inserted at.
+    size_t Insert(const Callback &callback) {
+        auto position = std::upper_bound(begin(), end(), callback.priority,
+                                         [](jint priority, const Callback &entry) {
+                                             return priority > entry.priority;
+                                         });
+        auto index = static_cast<size_t>(position - begin());
+        InsertAt(index, callback);
+        return index;
+    }
+
+    /// Inserts [callback] at [index] regardless of priority, which is how an erased entry is put
+    /// back where it was.
+    void InsertAt(size_t index, const Callback &callback) {
+        if (size_ == capacity_) Grow();
+        std::copy_backward(data_ + index, data_ + size_, data_ + size_ + 1);
+        data_[index] = callback;
+        ++size_;
+    }
+
+    void Erase(size_t index) {
+        std::copy(data_ + index + 1, data_ + size_, data_ + index);
+        --size_;
+    }
+
+    void Clear() { size_ = 0; }
+
+private:
+    void Grow() {
+        auto *grown = new Callback[capacity_ * 2];
+        std::copy(begin(), end(), grown);
+        if (data_ != inline_) delete[] data_;
+        data_ = grown;
+        capacity_ *= 2;
+    }
+
+    Callback inline_[kInline];
+    Callback *data_ = inline_;
+    uint32_t size_ = 0;
+    uint32_t capacity_ = kInline;
+};
+
 /**
  * @struct HookItem
  * @brief Holds all state associated with a single hooked method.
  *
- * This includes lists of all registered callback functions
- * (both modern and legacy), sorted by priority.
+ * This includes lists of all registered callback functions
+ * (both modern and legacy), sorted by priority.
+ *
+ * It also manages a thread-safe "backup" object,
+ * which is a handle to the original, un-hooked method.
+ */
+struct HookItem {
+    // Callbacks are stored highest priority first.
+    // Only writers touch these, under the monitor of the backup; hooked calls read the snapshot.
+    CallbackList legacy_callbacks;
+    CallbackList modern_callbacks;
+
+    // A global reference to the hooked Executable, which removing the hook hands back to lsplant.
+    jobject target = nullptr;
+
+    // The registry cell this item is published in, whose address the hooker holds as its handle.
+    HookCell *const cell;
+
+    // The backup's method ID, resolved once; valid whenever GetBackup returns non-null.
+    jmethodID backup_method = nullptr;
+
+    // Set under the monitor once the hook has been removed. A writer that finds it set raced the
+    // removal, and has to look the method up again rather than register on a dead item.
+    bool retired = false;
+
+private:
+    // The backup is an atomic jobject.
+    // This is crucial for thread safety during the initial hooking process.
+    // It can be in one of three states:
+    // - nullptr: The hook has not been initialized yet.
+    // - FAILED: The hook attempt failed.
+    // - A valid jobject: A handle to the original method.
+    std::atomic<jobject> backup{nullptr};
+    static_assert(decltype(backup)::is_always_lock_free);
+    // A sentinel value to indicate that the hooking process failed.
+    inline static jobject FAILED = reinterpret_cast<jobject>(std::numeric_limits<uintptr_t>::max());
+
+    // The callbacks as hooked calls see them. Null while there are none, which is what lets a
+    // hooked call skip the whole Java dispatch and run the backup.
+    std::atomic<CallbackSnapshot *> snapshot{nullptr};
+
+    // When the last callback went, on the steady clock; zero while any is registered.
+    std::atomic<int64_t> idle_since{0};
+
+    // Allocated by the first recorded call, so hooks that never run cost nothing.
+    std::atomic<HookStats *> stats{nullptr};
+
+    // Allocated when a callback first memoizes, and kept for the life of the item.
+    std::atomic<MemoTable *> memo{nullptr};
+
+public:
+    explicit HookItem(HookCell *cell) : cell(cell) {}
+
+    /**
+     * @brief Atomically and safely retrieves the backup method handle.
+     * If another thread is currently setting up the hook, this method will wait until
+     * the process is complete, to prevent race conditions.
+     */
+    jobject GetBackup() {
+        // Wait until the 'backup' atomic is no longer nullptr.
+        backup.wait(nullptr, std::memory_order_acquire);
+        if (auto bk = backup.load(std::memory_order_relaxed); bk != FAILED) {
+            return bk;
+        } else {
+            return nullptr;
+        }
+    }
+
+    /**
+     * @brief The backup if it is set already, without waiting for an install in progress.
+     *
+     * For @FastNative entries, which run in Runnable state and must not block: a hooked call that
+     * arrives between lsplant::Hook and SetBackup treats the method as having no callbacks yet,
+     * and the original it then runs through the regular invokeOriginal entry is the one to wait.
+     */
+    jobject PeekBackup() const {
+        auto bk = backup.load(std::memory_order_acquire);
+        return bk != FAILED ? bk : nullptr;
+    }
+
+    /**
+     * @brief Atomically sets the backup method handle once after hooking.
+     * This method uses compare_exchange_strong to ensure it only sets the value once.
+     * After setting, it notifies any waiting threads.
+     */
+    void SetBackup(jobject newBackup) {
+        jobject null = nullptr;
+        // Attempt to transition from nullptr to the new backup (or FAILED).
+        // memory_order_acq_rel ensures memory synchronization
+        // with both waiting threads (acquire) and subsequent reads (release).
+        backup.compare_exchange_strong(null, newBackup ? newBackup : FAILED,
+                                       std::memory_order_acq_rel, std::memory_order_relaxed);
+        // Wake up all threads that were waiting in GetBackup().
+        backup.notify_all();
+    }
+
+    /**
+     * @brief Returns a local reference to the current snapshot array, or nullptr if there are no
+     * callbacks to run. Takes no lock and allocates nothing on the Java heap.
+     */
+    jobjectArray LoadSnapshot(JNIEnv *env) {
+        EpochDomain::Guard guard;
+        auto *current = snapshot.load(std::memory_order_acquire);
+        if (current == nullptr) return nullptr;
+        return static_cast<jobjectArray>(env->NewLocalRef(current->callbacks));
+    }
+
+    /**
+     * @brief LoadSnapshot narrowed to the callbacks whose filters accept the call in [args], which
+     * holds the receiver first unless [is_static], as the trampoline passes them, and that do not
+     * skip it for being reentrant.
+     *
+     * Returns the shared snapshot when every callback takes the call, and nullptr when none does,
+     * so the hooker runs the original directly. Only a call some callbacks want and some do not
+     * gets arrays of its own. A call that enters the Java dispatch of a method with reentry
+     * tracking is pushed on [dispatching].
+     *
+     * When every callback memoizes, a call whose arguments were answered before gets the
+     * one-element Object[][] holding the remembered result instead, and runs nothing.
+     */
+    jobjectArray LoadSnapshot(JNIEnv *env, jobjectArray args, bool is_static) {
+        EpochDomain::Guard guard;
+        auto *current = snapshot.load(std::memory_order_acquire);
+        if (current == nullptr) return nullptr;
+        if (!current->observers.empty() && args) Observe(env, current, args, is_static);
+        if (current->modern_count + current->legacy_count == 0) return nullptr;
+        const bool memoized = current->memoized && args;
+        if (memoized) {
+            if (auto hit = LookupMemo(env, args, is_static)) return hit;
+        }
+        const bool tracked = !current->skips_reentry.empty();
+        const bool reentered =
+            tracked && std::find(dispatching.begin(), dispatching.end(), cell) != dispatching.end();
+        auto result = Narrow(env, current, args, is_static, reentered);
+        if (result && tracked) dispatching.push_back(cell);
+        if (memoized) {
+            SettleMemo(env, result != nullptr,
+                       result && env->IsSameObject(result, current->callbacks));
+        }
+        return result;
+    }
+
+    /**
+     * @brief Makes room for memoized results, for a method of [shorty]. Callers hold the monitor
+     * of the backup.
+     */
+    void EnableMemo(const std::string &shorty);
+
+    /**
+     * @brief Pops the memo entry of the call through [cell] leaving its Java dispatch now, and
+     * remembers [result] for it if LookupMemo found no result and every callback ran.
+     *
+     * The entry is popped whatever became of the hook meanwhile, as dispatching is: [hook_item] is
+     * the cell's current item, or nullptr once it is unhooked. The key is only filed into the table
+     * it was looked up in; otherwise its weak references are released here. The caller holds an
+     * EpochDomain::Guard.
+     */
+    static void RecordMemo(JNIEnv *env, const HookCell *cell, HookItem *hook_item,
+                           jobject result, bool returned);
+
+    /// Forgets every memoized result. @return How many there were.
+    size_t ClearMemo(JNIEnv *env);
+
+private:
+    /// The remembered result's hit array, or nullptr after noting the call on the memo stack.
+    jobjectArray LookupMemo(JNIEnv *env, jobjectArray args, bool is_static);
+
+    /// Pops what LookupMemo noted when [dispatched] is false, and keeps it from being remembered
+    /// unless [complete]: a call some filter or sampler narrowed ran a chain of its own.
+    void SettleMemo(JNIEnv *env, bool dispatched, bool complete);
+
+    static void Observe(JNIEnv *env, const CallbackSnapshot *current, jobjectArray args,
+                        bool is_static) {
+        jobject thiz = is_static ? nullptr : env->GetObjectArrayElement(args, 0);
+        const jsize first_arg = is_static ? 0 : 1;
+        for (const auto &observer : current->observers) {
+            if (observer.filter && !observer.filter->Matches(env, thiz, args, first_arg)) continue;
+            if (observer.sampler && !observer.sampler->Take()) continue;
+            observer.spec->Capture(env, thiz, args, first_arg);
+        }
+        if (thiz) env->DeleteLocalRef(thiz);
+    }
+
+    jobjectArray Narrow(JNIEnv *env, const CallbackSnapshot *current, jobjectArray args,
+                        bool is_static, bool reentered) {
+        if ((current->filters.empty() && current->samplers.empty() && !reentered) ||
+            args == nullptr) {
+            return static_cast<jobjectArray>(env->NewLocalRef(current->callbacks));
+        }
+
+        jobject thiz = is_static ? nullptr : env->GetObjectArrayElement(args, 0);
+        const jsize first_arg = is_static ? 0 : 1;
+        const jsize total = current->modern_count + current->legacy_count;
+        std::vector<bool> accepted(total);
+        jsize accepted_count = 0;
+        for (jsize i = 0; i < total; ++i) {
+            auto *filter = current->filters.empty() ? nullptr : current->filters[i];
+            auto *sampler = current->samplers.empty() ? nullptr : current->samplers[i];
+            // Sampled last, so that calls the callback would not have taken anyway do not use up
+            // its sample.
+            accepted[i] = !(reentered && current->skips_reentry[i]) &&
+                          (!filter || filter->Matches(env, thiz, args, first_arg)) &&
+                          (!sampler || sampler->Take());
+            if (accepted[i]) ++accepted_count;
+        }
+        if (thiz) env->DeleteLocalRef(thiz);
+
+        if (accepted_count == total) {
+            return static_cast<jobjectArray>(env->NewLocalRef(current->callbacks));
+        }
+        if (accepted_count == 0) return nullptr;
+
+        auto narrow = [&](jsize kind, jsize offset, jsize count) -> jobjectArray {
+            auto all =
+                static_cast<jobjectArray>(env->GetObjectArrayElement(current->callbacks, kind));
+            jsize kept = static_cast<jsize>(
+                std::count(accepted.begin() + offset, accepted.begin() + offset + count, true));
+            auto array = env->NewObjectArray(kept, object_class, nullptr);
+            if (array) {
+                for (jsize i = 0, j = 0; i < count; ++i) {
+                    if (!accepted[offset + i]) continue;
+                    auto callback = env->GetObjectArrayElement(all, i);
+                    env->SetObjectArrayElement(array, j++, callback);
+                    env->DeleteLocalRef(callback);
+                }
+            }
+            env->DeleteLocalRef(all);
+            return array;
+        };
+        auto modern = narrow(0, 0, current->modern_count);
+        auto legacy = modern ? narrow(1, current->modern_count, current->legacy_count) : nullptr;
+        auto pair = legacy ? env->NewObjectArray(2, object_array_class, nullptr) : nullptr;
+        if (pair) {
+            env->SetObjectArrayElement(pair, 0, modern);
+            env->SetObjectArrayElement(pair, 1, legacy);
+        }
+        if (modern) env->DeleteLocalRef(modern);
+        if (legacy) env->DeleteLocalRef(legacy);
+        return pair;
+    }
+
+public:
+    /// Counts one hooked call, [total] ns long of which [original] were spent in the original.
+    void RecordInvocation(int64_t total, int64_t original) {
+        auto *current = stats.load(std::memory_order_acquire);
+        if (current == nullptr) {
+            auto *fresh = new HookStats();
+            if (stats.compare_exchange_strong(current, fresh, std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+                current = fresh;
+            } else {
+                delete fresh;
+            }
+        }
+        original = std::clamp<int64_t>(original, 0, total);
+        current->Record(static_cast<uint64_t>(total - original), static_cast<uint64_t>(original));
+    }
+
+    /// The counters so far, or nullptr before the first recorded call.
+    const HookStats *Stats() const { return stats.load(std::memory_order_acquire); }
+
+    /// Whether the hook has had no callbacks since at or before [deadline].
+    bool IdleSince(int64_t deadline) const {
+        auto since = idle_since.load(std::memory_order_relaxed);
+        return since != 0 && since <= deadline;
+    }
+
+    /**
+     * @brief Rebuilds the snapshot from the callback lists and publishes it.
+     * Callers hold the monitor of the backup, which is what serialises writers.
+     * @return false when the arrays could not be allocated; the previous snapshot then stays.
+     */
+    bool PublishSnapshot(JNIEnv *env) {
+        // Results remembered under the previous callbacks are not theirs to give.
+        ClearMemo(env);
+        if (modern_callbacks.empty() && legacy_callbacks.empty()) {
+            auto *previous = snapshot.exchange(nullptr, std::memory_order_acq_rel);
+            if (idle_since.exchange(SteadyNow(), std::memory_order_relaxed) == 0) {
+                idle_hooks.fetch_add(1, std::memory_order_relaxed);
+            }
+            EpochDomain::Instance().Retire(env, previous, &CallbackSnapshot::Delete);
+            return true;
+        }
+
+        // Observers run off the hooked thread, so only the other callbacks go to Java.
+        auto dispatched = [](const CallbackList &callbacks) {
+            return static_cast<jsize>(std::count_if(
+                callbacks.begin(), callbacks.end(),
+                [](const auto &callback) { return callback.observer() == nullptr; }));
+        };
+        auto fill = [env, &dispatched](const CallbackList &callbacks) -> jobjectArray {
+            auto array = env->NewObjectArray(dispatched(callbacks), object_class, nullptr);
+            if (array == nullptr) return nullptr;
+            jsize i = 0;
+            for (const auto &callback : callbacks) {
+                if (callback.observer()) continue;
+                env->SetObjectArrayElement(array, i++, callback.object);
+            }
+            return array;
+        };
+
+        auto modern = fill(modern_callbacks);
+        auto legacy = modern ? fill(legacy_callbacks) : nullptr;
+        auto pair = legacy ? env->NewObjectArray(2, object_array_class, nullptr) : nullptr;
+        if (pair) {
+            env->SetObjectArrayElement(pair, 0, modern);
+            env->SetObjectArrayElement(pair, 1, legacy);
+        }
+        auto global = pair ? static_cast<jobjectArray>(env->NewGlobalRef(pair)) : nullptr;
+        if (modern) env->DeleteLocalRef(modern);
+        if (legacy) env->DeleteLocalRef(legacy);
+        if (pair) env->DeleteLocalRef(pair);
+        if (global == nullptr) return false;
+
+        auto *next = new CallbackSnapshot{global, dispatched(modern_callbacks),
+                                          dispatched(legacy_callbacks), {}, {}, {}, {}};
+        auto filtered = [](const CallbackList &callbacks) {
+            return std::any_of(callbacks.begin(), callbacks.end(), [](const auto &callback) {
+                return callback.filter() != nullptr && callback.observer() == nullptr;
+            });
+        };
+        if (filtered(modern_callbacks) || filtered(legacy_callbacks)) {
+            for (const auto *callbacks : {&modern_callbacks, &legacy_callbacks}) {
+                for (const auto &callback : *callbacks) {
+                    if (!callback.observer()) next->filters.push_back(callback.filter());
+                }
+            }
+        }
+        auto sampled = [](const CallbackList &callbacks) {
+            return std::any_of(callbacks.begin(), callbacks.end(), [](const auto &callback) {
+                return callback.sampler() != nullptr && callback.observer() == nullptr;
+            });
+        };
+        if (sampled(modern_callbacks) || sampled(legacy_callbacks)) {
+            for (const auto *callbacks : {&modern_callbacks, &legacy_callbacks}) {
+                for (const auto &callback : *callbacks) {
+                    if (!callback.observer()) next->samplers.push_back(callback.sampler());
+                }
+            }
+        }
+        auto skipping = [](const CallbackList &callbacks) {
+            return std::any_of(callbacks.begin(), callbacks.end(), [](const auto &callback) {
+                return callback.skips_reentry() && callback.observer() == nullptr;
+            });
+        };
+        if (skipping(modern_callbacks) || skipping(legacy_callbacks)) {
+            for (const auto *callbacks : {&modern_callbacks, &legacy_callbacks}) {
+                for (const auto &callback : *callbacks) {
+                    if (!callback.observer()) {
+                        next->skips_reentry.push_back(callback.skips_reentry());
+                    }
+                }
+            }
+        }
+        next->memoized = memo.load(std::memory_order_relaxed) &&
+                         next->modern_count + next->legacy_count > 0;
+        for (const auto *callbacks : {&modern_callbacks, &legacy_callbacks}) {
+            for (const auto &callback : *callbacks) {
+                if (!callback.observer() && !callback.memoizes()) next->memoized = false;
+            }
+        }
+        for (const auto *callbacks : {&modern_callbacks, &legacy_callbacks}) {
+            for (const auto &callback : *callbacks) {
+                if (!callback.observer()) continue;
+                next->observers.push_back(
+                    {callback.filter(), callback.sampler(), callback.observer()});
+            }
+        }
+        auto *previous = snapshot.exchange(next, std::memory_order_acq_rel);
+        if (idle_since.exchange(0, std::memory_order_relaxed) != 0) {
+            idle_hooks.fetch_sub(1, std::memory_order_relaxed);
+        }
+        EpochDomain::Instance().Retire(env, previous, &CallbackSnapshot::Delete);
+        return true;
+    }
+
+    static void DeleteMemo(JNIEnv *env, MemoTable *table);
+
+    /// Frees a retired item. Nothing can reach it any more, its snapshot included.
+    static void Delete(JNIEnv *env, void *ptr) {
+        auto *item = static_cast<HookItem *>(ptr);
+        if (auto *current = item->snapshot.load(std::memory_order_relaxed)) {
+            CallbackSnapshot::Delete(env, current);
+        }
+        for (auto *callbacks : {&item->modern_callbacks, &item->legacy_callbacks}) {
+            for (const auto &callback : *callbacks) {
+                env->DeleteGlobalRef(callback.object);
+                if (callback.filter()) {
+                    CallbackFilter::Delete(env, const_cast<CallbackFilter *>(callback.filter()));
+                }
+                if (callback.observer()) {
+                    ObserverSpec::Delete(env, const_cast<ObserverSpec *>(callback.observer()));
+                }
+                delete callback.sampler();
+                delete callback.options;
+            }
+        }
+        delete item->stats.load(std::memory_order_relaxed);
+        DeleteMemo(env, item->memo.load(std::memory_order_relaxed));
+        if (auto bk = item->backup.load(std::memory_order_relaxed); bk && bk != FAILED) {
+            env->DeleteGlobalRef(bk);
+        }
+        env->DeleteGlobalRef(item->target);
+        delete item;
+    }
+};
+
+// A type alias for a thread-safe parallel hash map.
+// It uses a std::shared_mutex to allow concurrent reads but exclusive writes.
+template <class K, class V, class Hash = phmap::priv::hash_default_hash<K>,
+          class Eq = phmap::priv::hash_default_eq<K>,
+          class Alloc = phmap::priv::Allocator<phmap::priv::Pair<const K, V>>, size_t N = 4>
+using SharedHashMap = phmap::parallel_flat_hash_map<K, V, Hash, Eq, Alloc, N, std::shared_mutex>;
+
+struct InvokePlan;
+
+/**
+ * @struct HookCell
+ * @brief The permanent home of one hooked method in the registry, and the handle its hookers get.
+ *
+ * A cell is created the first time a method is hooked and never freed, so a handle stays safe to
+ * dereference however late a call comes in. It points at the method's current HookItem, which is
+ * null while the method is not hooked, and is reused if the method is hooked again.
+ */
+struct HookCell {
+    jmethodID target;
+    std::atomic<HookItem *> item{nullptr};
+    // Resolved on the first invokeOriginal through this cell.
+    std::atomic<const InvokePlan *> plan{nullptr};
+    // The method's entry in the trace's method table, once HookTrace::NameMethod has named it.
+    std::atomic<uint32_t> trace_id{0};
+
+    jlong Handle() { return static_cast<jlong>(reinterpret_cast<uintptr_t>(this)); }
+    static HookCell *FromHandle(jlong handle) {
+        return reinterpret_cast<HookCell *>(static_cast<uintptr_t>(handle));
+    }
+};
+
+/**
+ * @class HookIndex
+ * @brief The registry of hooked methods, mapping a method's ID to its HookCell, with lookups that
+ * take no lock.
+ *
+ * Every hooked call looks its method up, so lookups do nothing but probe an open-addressed array of
+ * atomic slots, under an EpochDomain::Guard. Writers are rare and serialised by one mutex. Cells are
+ * never removed, so a probe never has to tell a removed key from a missing one; removing a hook
+ * only clears its cell. The table doubles when half full, and the old table is retired through the
+ * epoch domain so probes still in it can finish.
+ */
+class HookIndex {
+public:
+    HookIndex() : table_(Table::New(kMinCapacity)) {}
+
+    /// The cell of [target], or nullptr if it was never hooked. The caller holds a Guard.
+    HookCell *FindCell(jmethodID target) const {
+        const auto *table = table_.load(std::memory_order_acquire);
+        for (size_t i = table->Home(target);; i = (i + 1) & table->mask) {
+            auto key = table->slots[i].key.load(std::memory_order_acquire);
+            if (key == target) return table->slots[i].cell.load(std::memory_order_acquire);
+            if (key == nullptr) return nullptr;
+        }
+    }
+
+    /// The item of [target], or nullptr. The caller holds an EpochDomain::Guard.
+    HookItem *Find(jmethodID target) const {
+        auto *cell = FindCell(target);
+        return cell ? cell->item.load(std::memory_order_acquire) : nullptr;
+    }
+
+    /**
+     * @brief Returns the item of [target], creating it with [make] when there is none, in which
+     * case [inserted] is set. The caller holds an EpochDomain::Guard.
+     */
+    template <class Make>
+    HookItem *FindOrInsert(JNIEnv *env, jmethodID target, Make &&make, bool &inserted) {
+        if (auto *item = Find(target)) return item;
+
+        std::lock_guard lk(write_lock_);
+        auto *table = table_.load(std::memory_order_relaxed);
+        auto *slot = &table->Probe(target);
+        auto *cell = slot->cell.load(std::memory_order_relaxed);
+        if (cell == nullptr) {
+            if ((used_ + 1) * 2 > table->mask + 1) {
+                table = Grow(env, table);
+                slot = &table->Probe(target);
+            }
+            cell = new HookCell{target};
+            ++used_;
+            // The cell goes in first, so that a reader that sees the key sees it too.
+            slot->cell.store(cell, std::memory_order_release);
+            slot->key.store(target, std::memory_order_release);
+        } else if (auto *item = cell->item.load(std::memory_order_relaxed)) {
+            return item;
+        }
+
+        HookItem *item = make(cell);
+        cell->item.store(item, std::memory_order_release);
+        inserted = true;
+        return item;
+    }
+
+    /// Clears the cell of [target] if it still holds [item].
+    void Erase(jmethodID target, HookItem *item) {
+        std::lock_guard lk(write_lock_);
+        if (auto *cell = FindCell(target)) {
+            cell->item.compare_exchange_strong(item, nullptr, std::memory_order_release,
+                                               std::memory_order_relaxed);
+        }
+    }
+
+    /// Calls [f] with every hooked method and its item. The caller holds an EpochDomain::Guard.
+    template <class F>
+    void ForEach(F &&f) const {
+        const auto *table = table_.load(std::memory_order_acquire);
+        for (size_t i = 0; i <= table->mask; ++i) {
+            auto *cell = table->slots[i].cell.load(std::memory_order_acquire);
+            if (cell == nullptr) continue;
+            if (auto *item = cell->item.load(std::memory_order_acquire)) f(cell->target, item);
+        }
+    }
+
+private:
+    static constexpr size_t kMinCapacity = 64;
+
+    struct Slot {
+        std::atomic<jmethodID> key{nullptr};
+        std::atomic<HookCell *> cell{nullptr};
+    };
+
+    struct Table {
+        size_t mask;
+        int shift;
+        std::unique_ptr<Slot[]> slots;
+
+        static Table *New(size_t capacity) {
+            return new Table{capacity - 1, 64 - std::countr_zero(capacity),
+                             std::make_unique<Slot[]>(capacity)};
+        }
+
+        static void Delete(JNIEnv *, void *ptr) { delete static_cast<Table *>(ptr); }
+
+        // Fibonacci hashing: method IDs are aligned pointers, so the low bits carry nothing.
+        size_t Home(jmethodID target) const {
+            auto key = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(target));
+            return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> shift);
+        }
+
+        /// The slot holding [target], or the empty one it would go in. Writers only.
+        Slot &Probe(jmethodID target) {
+            for (size_t i = Home(target);; i = (i + 1) & mask) {
+                auto key = slots[i].key.load(std::memory_order_relaxed);
+                if (key == target || key == nullptr) return slots[i];
+            }
+        }
+    };
+
+    /// Moves every cell to a table twice the size and publishes it.
+    Table *Grow(JNIEnv *env, Table *old) {
+        auto *grown = Table::New((old->mask + 1) * 2);
+        for (size_t i = 0; i <= old->mask; ++i) {
+            auto *cell = old->slots[i].cell.load(std::memory_order_relaxed);
+            if (!cell) continue;
+            auto &slot = grown->Probe(cell->target);
+            slot.cell.store(cell, std::memory_order_relaxed);
+            slot.key.store(cell->target, std::memory_order_relaxed);
+        }
+        table_.store(grown, std::memory_order_release);
+        EpochDomain::Instance().Retire(env, old, &Table::Delete);
+        return grown;
+    }
+
+    std::atomic<Table *> table_;
+    std::mutex write_lock_;
+    // Slots with a key in the current table.
+    size_t used_ = 0;
+};
+
+// The global registry of all hooked methods.
+HookIndex hooked_methods;
+
+// Cached JNI method and field IDs for performance.
+jmethodID invoke = nullptr;
+// Reflection on the executables invoke plans are built from, and arrays of them.
+jclass executable_class = nullptr;
+jclass method_class = nullptr;
+jmethodID get_parameter_types = nullptr;
+jmethodID get_declaring_class = nullptr;
+jmethodID get_modifiers = nullptr;
+jmethodID get_return_type = nullptr;
+
+// Every owner a callback has been attributed to, indexed by id. Slot 0 is no owner at all.
+std::mutex owners_lock;
+std::vector<jobject> owners{nullptr};
+
+/**
+ * @struct HookerInfo
+ * @brief What installing a hook needs to know about a hooker class, resolved once per class.
+ */
+struct HookerInfo {
+    jclass hooker;            // Global reference.
+    jmethodID init;           // <init>(Executable, long handle)
+    jobject callback_method;  // Global reference to the reflected callback(Object[]).
+};
+
+/**
+ * @brief Returns the cached HookerInfo of [hooker], resolving it on first use.
+ *
+ * In practice there is a single hooker class for the whole process, so this is a short scan and
+ * entries are never dropped.
+ */
+const HookerInfo *GetHookerInfo(JNIEnv *env, jclass hooker) {
+    static std::mutex lock;
+    static std::vector<std::unique_ptr<HookerInfo>> hookers;
+
+    std::lock_guard lk(lock);
+    for (const auto &info : hookers) {
+        if (env->IsSameObject(info->hooker, hooker)) return info.get();
+    }
+
+    auto init = env->GetMethodID(hooker, "<init>", "(Ljava/lang/reflect/Executable;J)V");
+    auto callback = env->GetMethodID(hooker, "callback", "([Ljava/lang/Object;)Ljava/lang/Object;");
+    if (!init || !callback) return nullptr;
+    auto callback_method = env->ToReflectedMethod(hooker, callback, false);
+    if (!callback_method) return nullptr;
+
+    auto &info = hookers.emplace_back(new HookerInfo{
+        static_cast<jclass>(env->NewGlobalRef(hooker)), init, env->NewGlobalRef(callback_method)});
+    env->DeleteLocalRef(callback_method);
+    return info.get();
+}
+
+/**
+ * @brief Returns the id callbacks registered on behalf of [owner] are attributed to, interning it
+ * on first use.
+ *
+ * Owners are the class loaders of the modules that register hooks, of which a process has a
+ * handful, so this is a short scan and ids are never reused. Id 0 stands for no owner.
+ */
+jint GetOwnerId(JNIEnv *env, jobject owner) {
+    std::lock_guard lk(owners_lock);
+    for (size_t i = 0; i < owners.size(); ++i) {
+        if (env->IsSameObject(owners[i], owner)) return static_cast<jint>(i);
+    }
+    owners.push_back(env->NewGlobalRef(owner));
+    return static_cast<jint>(owners.size() - 1);
+}
+
+/**
+ * @brief Looks up the HookItem of [target]. The caller holds an EpochDomain::Guard for as long as
+ * it uses the result, which is what keeps a concurrently removed item alive.
+ */
+HookItem *FindHookItem(jmethodID target) { return hooked_methods.Find(target); }
+
+/**
+ * @class HookTrace
+ * @brief An opt-in ring of hook dispatch events in a memfd, for latency work the aggregates of
+ * hookStats cannot answer: one record per hooked call, with its timestamp, thread, method, callback
+ * count and how long the calls before, the original and the calls after took.
+ *
+ * The daemon runs as root, so it finds the buffer among /proc/<pid>/fd as
+ * "/memfd:vector-hook-trace" and maps it on its own; the process is never asked. That makes the
+ * layout a format, which the daemon's HookTraceReader mirrors: bump kVersion on any change to it.
+ *
+ * A writer claims a slot with one fetch_add on the head and publishes it seqlock-style: it zeroes
+ * the slot's sequence, writes the fields and then stores its claim plus one. A reader keeps a
+ * record only when that sequence reads the same before and after copying it. Writers never wait on
+ * each other, and a slow one only ever costs the record it was writing.
+ *
+ * Tracing stops but the buffer stays: the mapping is never torn down, so a writer that loaded the
+ * region before it stopped cannot fault, and the daemon can still dump the last events. While
+ * tracing is off, a hooked call pays one relaxed load for it.
+ */
+class HookTrace {
+public:
+    static constexpr uint32_t kMagic = 0x52544856;  // "VHTR"
+    static constexpr uint32_t kVersion = 1;
+    static constexpr uint32_t kMethodCapacity = 4096;
+    static constexpr uint32_t kMethodNameSize = 256;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t header_size;       // Where the method table starts.
+        uint32_t record_size;
+        uint32_t capacity;          // Records, a power of two. The records follow the table.
+        uint32_t method_capacity;
+        uint32_t method_name_size;  // Bytes per table entry, NUL-padded modified UTF-8.
+        uint32_t pid;
+        std::atomic<uint64_t> head;  // Records ever claimed; the newest is at head - 1.
+        std::atomic<uint32_t> method_count;
+        uint32_t clock;              // The clock_gettime clock of start_ns.
+    };
+
+    struct alignas(64) Event {
+        std::atomic<uint64_t> sequence;  // Claim + 1 once written, 0 while being written.
+        uint64_t start_ns;
+        uint64_t before_ns;    // From entering the hook to the first call of the original.
+        uint64_t original_ns;  // In the original, across every call of it.
+        uint64_t after_ns;     // The rest: callbacks after the original, and between calls of it.
+        uint32_t tid;
+        uint32_t method_id;    // 1-based index into the method table; 0 while unnamed.
+        uint32_t callbacks;    // Callbacks that ran: modern and legacy, after filtering.
+        uint32_t reserved;
+    };
+    static_assert(sizeof(Event) == 64);
+    static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+    static HookTrace &Instance() {
+        static HookTrace trace;
+        return trace;
+    }
+
+    bool Enabled() const { return active_.load(std::memory_order_relaxed) != nullptr; }
+
+    /**
+     * @brief Starts tracing into a buffer of at least [capacity] records, creating it on first
+     * use. A buffer that already exists is kept as it is, whatever [capacity] says. Methods hooked
+     * so far are named here; later ones are named as they are hooked.
+     */
+    bool Start(JNIEnv *env, uint32_t capacity) {
+        if (!Create(capacity)) return false;
+        std::vector<HookCell *> cells;
+        {
+            EpochDomain::Guard guard;
+            hooked_methods.ForEach(
+                [&cells](jmethodID, HookItem *item) { cells.push_back(item->cell); });
+        }
+        for (auto *cell : cells) {
+            jobject target = nullptr;
+            {
+                EpochDomain::Guard guard;
+                auto *item = cell->item.load(std::memory_order_acquire);
+                if (item && item->target) target = env->NewLocalRef(item->target);
+            }
+            if (!target) continue;
+            NameMethod(env, cell, target);
+            env->DeleteLocalRef(target);
+        }
+        return true;
+    }
+
+    void Stop() { active_.store(nullptr, std::memory_order_release); }
+
+    /**
+     * @brief Writes [target], the method of [cell], into the method table once, so the events of
+     * its calls can refer to it. Nothing happens before the buffer exists; Start names whatever is
+     * hooked by then.
+     *
+     * It calls toString, so it runs from regular natives only: never on the path of a hooked call,
+     * where an upcall would hold off a suspension and could reach a traced method again. The
+     * mutex is not held across the upcall either. The name is written before the id is handed
+     * out, so no record can refer to a partial one.
+     */
+    void NameMethod(JNIEnv *env, HookCell *cell, jobject target) {
+        if (cell->trace_id.load(std::memory_order_acquire) != 0) return;
+        {
+            std::lock_guard lk(lock_);
+            if (!header_ || header_->method_count.load(std::memory_order_relaxed) >=
+                                header_->method_capacity) {
+                return;
+            }
+        }
+        auto name = static_cast<jstring>(env->CallObjectMethod(target, to_string_method));
+        if (!name) {
+            env->ExceptionClear();
+            return;
+        }
+        std::string chars;
+        if (auto *utf = env->GetStringUTFChars(name, nullptr)) {
+            chars = utf;
+            env->ReleaseStringUTFChars(name, utf);
+        }
+        env->DeleteLocalRef(name);
+
+        std::lock_guard lk(lock_);
+        auto *header = header_;
+        if (cell->trace_id.load(std::memory_order_relaxed) != 0) return;
+        auto count = header->method_count.load(std::memory_order_relaxed);
+        if (count >= header->method_capacity) return;
+        auto *entry = reinterpret_cast<char *>(header) + header->header_size +
+                      size_t{count} * header->method_name_size;
+        std::strncpy(entry, chars.c_str(), header->method_name_size - 1);
+        header->method_count.store(count + 1, std::memory_order_release);
+        cell->trace_id.store(count + 1, std::memory_order_release);
+    }
+
+    /**
+     * @brief Appends one event for a call through [cell]. [start_ns] is on CLOCK_MONOTONIC, which
+     * is what System.nanoTime reads. Only atomics are touched: a method not named yet, or hooked
+     * past the table's capacity, is recorded with method id 0.
+     */
+    void Record(HookCell *cell, jlong start_ns, jlong total_ns, jlong original_ns,
+                jlong before_ns, jint callbacks) {
+        auto *header = active_.load(std::memory_order_acquire);
+        if (!header) return;
+
+        const auto method_id = cell->trace_id.load(std::memory_order_acquire);
+        const uint64_t claim = header->head.fetch_add(1, std::memory_order_relaxed);
+        auto &record = Events(header)[claim & (header->capacity - 1)];
+        record.sequence.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        record.start_ns = static_cast<uint64_t>(start_ns);
+        record.before_ns = static_cast<uint64_t>(before_ns);
+        record.original_ns = static_cast<uint64_t>(original_ns);
+        record.after_ns = static_cast<uint64_t>(std::max<jlong>(
+            total_ns - before_ns - original_ns, 0));
+        record.tid = static_cast<uint32_t>(gettid());
+        record.method_id = method_id;
+        record.callbacks = static_cast<uint32_t>(callbacks);
+        record.reserved = 0;
+        record.sequence.store(claim + 1, std::memory_order_release);
+    }
+
+private:
+    // Maps the buffer on first use and turns recording on.
+    bool Create(uint32_t capacity) {
+        std::lock_guard lk(lock_);
+        if (!header_) {
+            capacity = std::bit_ceil(std::clamp<uint32_t>(capacity, 1024, 1u << 20));
+            const size_t header_size = 4096;
+            const size_t size = header_size + size_t{kMethodCapacity} * kMethodNameSize +
+                                size_t{capacity} * sizeof(Event);
+            int fd = static_cast<int>(syscall(__NR_memfd_create, "vector-hook-trace", 0));
+            if (fd < 0) {
+                PLOGE("memfd_create for the hook trace");
+                return false;
+            }
+            void *base = ftruncate(fd, static_cast<off_t>(size)) == 0
+                             ? mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                             : MAP_FAILED;
+            if (base == MAP_FAILED) {
+                PLOGE("mapping the hook trace");
+                close(fd);
+                return false;
+            }
+            // The descriptor stays open for the life of the process: it is what the daemon finds.
+            auto *header = new (base) Header{};
+            header->header_size = header_size;
+            header->record_size = sizeof(Event);
+            header->capacity = capacity;
+            header->method_capacity = kMethodCapacity;
+            header->method_name_size = kMethodNameSize;
+            header->pid = static_cast<uint32_t>(getpid());
+            header->clock = CLOCK_MONOTONIC;
+            header->version = kVersion;
+            // Last, so a reader that sees the magic sees a complete header.
+            std::atomic_ref(header->magic).store(kMagic, std::memory_order_release);
+            header_ = header;
+        }
+        active_.store(header_, std::memory_order_release);
+        return true;
+    }
+
+    static Event *Events(Header *header) {
+        auto *base = reinterpret_cast<char *>(header) + header->header_size +
+                     size_t{header->method_capacity} * header->method_name_size;
+        return reinterpret_cast<Event *>(base);
+    }
+
+    std::atomic<Header *> active_{nullptr};
+    Header *header_ = nullptr;  // Under lock_; never unmapped once created.
+    std::mutex lock_;
+};
+
+/**
+ * @brief Removes the hook on [target] if it has had no callbacks since [deadline].
+ *
+ * lsplant restores the original entry point, so the method runs at full speed again and a later
+ * hookMethod installs a fresh trampoline. A call already inside the old one finds no item, and
+ * invokeOriginalMethod then runs the method itself, which is now the original.
+ */
+bool ReclaimIdleHook(JNIEnv *env, jmethodID target, int64_t deadline) {
+    EpochDomain::Guard guard;
+    auto *hook_item = FindHookItem(target);
+    if (!hook_item) return false;
+    // A hook that failed to install has nothing to remove.
+    jobject backup = hook_item->GetBackup();
+    if (!backup) return false;
+
+    lsplant::JNIMonitor monitor(env, backup);
+    if (hook_item->retired || !hook_item->IdleSince(deadline)) return false;
+    if (!lsplant::UnHook(env, hook_item->target)) return false;
+
+    hook_item->retired = true;
+    hooked_methods.Erase(target, hook_item);
+    idle_hooks.fetch_sub(1, std::memory_order_relaxed);
+    // The epoch domain frees it once no reader can hold it.
+    EpochDomain::Instance().Retire(env, hook_item, &HookItem::Delete);
+    return true;
+}
+
+/**
+ * @brief Removes every hook that has been idle for longer than the configured timeout.
+ * Runs on the writer paths, so it costs one load when there is nothing idle.
+ * @return The number of hooks removed.
+ */
+jint ReclaimIdleHooks(JNIEnv *env) {
+    if (idle_hooks.load(std::memory_order_relaxed) == 0) return 0;
+    const auto timeout = idle_hook_timeout.load(std::memory_order_relaxed);
+    if (timeout < 0) return 0;
+    const auto deadline = SteadyNow() - timeout;
+
+    // Collected first: removing a hook takes its monitor, which is not taken while walking.
+    std::vector<jmethodID> expired;
+    {
+        EpochDomain::Guard guard;
+        hooked_methods.ForEach([&expired, deadline](jmethodID target, HookItem *hook_item) {
+            if (hook_item->IdleSince(deadline)) expired.push_back(target);
+        });
+    }
+
+    jint reclaimed = 0;
+    for (auto target : expired) {
+        if (ReclaimIdleHook(env, target, deadline)) ++reclaimed;
+    }
+    return reclaimed;
+}
+
+/**
+ * @struct CallbackEdit
+ * @brief One change to a hook's callbacks: [old_callback] replaced by [new_callback] at
+ * [new_priority], or removed when [new_callback] is null.
+ */
+struct CallbackEdit {
+    jsize index;  // Position in the caller's arrays.
+    jmethodID target;
+    jobject old_callback;
+    jobject new_callback;
+    jint new_priority;
+    bool applied = false;
+};
+
+/// Frees a filter no list holds any more, once no call can still be evaluating it.
+void RetireFilter(JNIEnv *env, const CallbackFilter *filter) {
+    EpochDomain::Instance().Retire(env, const_cast<CallbackFilter *>(filter),
+                                   &CallbackFilter::Delete);
+}
+
+/// Frees an observer spec no list holds any more, once no call can still be capturing with it.
+void RetireObserver(JNIEnv *env, const ObserverSpec *spec) {
+    EpochDomain::Instance().Retire(env, const_cast<ObserverSpec *>(spec), &ObserverSpec::Delete);
+}
+
+/// Frees a sampler no list holds any more, once no call can still be drawing from it.
+void RetireSampler(JNIEnv *env, const CallbackSampler *sampler) {
+    EpochDomain::Instance().Retire(env, const_cast<CallbackSampler *>(sampler),
+                                   &CallbackSampler::Delete);
+}
+
+/// Frees the options of an entry no list holds any more, retiring what snapshots point at.
+void RetireOptions(JNIEnv *env, CallbackOptions *options) {
+    if (!options) return;
+    if (options->filter) RetireFilter(env, options->filter);
+    if (options->observer) RetireObserver(env, options->observer);
+    if (options->sampler) RetireSampler(env, options->sampler);
+    delete options;
+}
+
+/**
+ * @brief Applies every edit in [edits], which all target the same method, under one monitor and
+ * with one publication. A hook whose snapshot cannot be published is left as it was, with none of
+ * the edits applied. The caller holds an EpochDomain::Guard.
+ */
+void EditCallbacks(JNIEnv *env, bool useModernApi, std::span<CallbackEdit> edits) {
+    auto *hook_item = FindHookItem(edits.front().target);
+    if (!hook_item) return;
+    jobject backup = hook_item->GetBackup();
+    if (!backup) return;
+
+    lsplant::JNIMonitor monitor(env, backup);
+    if (hook_item->retired) return;
+
+    auto &callbacks = useModernApi ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
+    const std::vector<Callback> before(callbacks.begin(), callbacks.end());
+    std::vector<jobject> released;
+    std::vector<jobject> acquired;
+    std::vector<CallbackOptions *> dropped;
+
+    for (auto &edit : edits) {
+        for (size_t i = 0; i < callbacks.size(); ++i) {
+            if (!env->IsSameObject(callbacks[i].object, edit.old_callback)) continue;
+
+            auto entry = callbacks[i];
+            if (edit.new_callback == nullptr) {
+                callbacks.Erase(i);
+                if (entry.options) dropped.push_back(entry.options);
+            } else {
+                auto replacement = env->NewGlobalRef(edit.new_callback);
+                if (!replacement) break;
+                acquired.push_back(replacement);
+                // Same rules as replaceCallback: the place among equal priorities and the
+                // attribution both carry over.
+                if (entry.priority == edit.new_priority) {
+                    callbacks[i].object = replacement;
+                } else {
+                    auto moved = entry;
+                    moved.object = replacement;
+                    moved.priority = edit.new_priority;
+                    callbacks.Erase(i);
+                    callbacks.Insert(moved);
+                }
+            }
+            released.push_back(entry.object);
+            edit.applied = true;
+            break;
+        }
+    }
+    if (released.empty()) return;
+
+    if (!hook_item->PublishSnapshot(env)) {
+        // Restore the list wholesale, so it keeps matching what is published.
+        callbacks.Clear();
+        for (const auto &callback : before) callbacks.InsertAt(callbacks.size(), callback);
+        for (auto ref : acquired) env->DeleteGlobalRef(ref);
+        for (auto &edit : edits) edit.applied = false;
+        return;
+    }
+    for (auto ref : released) env->DeleteGlobalRef(ref);
+    for (auto *options : dropped) RetireOptions(env, options);
+}
+
+/**
+ * @struct PendingHook
+ * @brief One callback to register on a method, as hookMethod is asked for it.
+ */
+struct PendingHook {
+    bool modern;
+    jobject callback;
+    jint priority;
+    jint owner;
+};
+
+/**
+ * @brief Registers every callback in [hooks] on [hookMethod] with one publication, installing the
+ * trampoline first if the method is not hooked yet. Either all of them are registered or none is.
+ * The caller holds an EpochDomain::Guard.
+ */
+bool HookCallbacks(JNIEnv *env, jobject hookMethod, const HookerInfo &hooker,
+                   std::span<const PendingHook> hooks) {
+    bool newHook = false;
+
+#ifndef NDEBUG
+    // Simple RAII struct for performance timing in debug builds.
+    struct finally {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        bool &newHook;
+        ~finally() {
+            auto finish = std::chrono::steady_clock::now();
+            if (newHook) {
+                LOGV("New hook took {}us",
+                     std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count());
+            }
+        }
+    } finally{.newHook = newHook};
+#endif
+
+    auto target = env->FromReflectedMethod(hookMethod);
+    if (!target) return false;
+
+    // Only loops when an idle hook on this very method was removed while we waited for it.
+    while (true) {
+        // Atomically find or create an entry for the target method, marking a new one as a new
+        // hook.
+        HookItem *hook_item = hooked_methods.FindOrInsert(
+            env, target, [](HookCell *cell) { return new HookItem(cell); }, newHook);
+
+        // If this is the first time this method is being hooked,
+        // we need to perform the actual native hook using lsplant.
+        if (newHook) {
+            auto hooker_object = env->NewObject(hooker.hooker, hooker.init, hookMethod,
+                                                hook_item->cell->Handle());
+            hook_item->target = env->NewGlobalRef(hookMethod);
+            // Use lsplant to replace the target method with our trampoline.
+            // The returned jobject is a handle to the original method. lsplant frees it when the
+            // hook is removed, so the item keeps a reference of its own.
+            auto backup =
+                hooker_object ? lsplant::Hook(env, hookMethod, hooker_object, hooker.callback_method)
+                              : nullptr;
+            if (backup) hook_item->backup_method = env->FromReflectedMethod(backup);
+            hook_item->SetBackup(backup ? env->NewGlobalRef(backup) : nullptr);
+            if (hooker_object) env->DeleteLocalRef(hooker_object);
+            if (backup) HookTrace::Instance().NameMethod(env, hook_item->cell, hookMethod);
+        }
+
+        // Wait for the backup to become available (it might be set by another thread).
+        jobject backup = hook_item->GetBackup();
+        if (!backup) return false;
+
+        // Use an RAII monitor to lock the backup object,
+        // ensuring thread-safe modification of the callback lists.
+        lsplant::JNIMonitor monitor(env, backup);
+        if (hook_item->retired) continue;
+
+        // Store a global reference to the callback object itself.
+        for (const auto &hook : hooks) {
+            auto &callbacks =
+                hook.modern ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
+            callbacks.Insert(Callback{env->NewGlobalRef(hook.callback), hook.owner, hook.priority});
+        }
+
+        // Hooked calls only see what is published; a callback that cannot be is not registered.
+        if (!hook_item->PublishSnapshot(env)) {
+            for (const auto &hook : hooks) {
+                auto &callbacks =
+                    hook.modern ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
+                for (size_t i = callbacks.size(); i-- > 0;) {
+                    if (!env->IsSameObject(callbacks[i].object, hook.callback)) continue;
+                    env->DeleteGlobalRef(callbacks[i].object);
+                    callbacks.Erase(i);
+                    break;
+                }
+            }
+            return false;
+        }
+        return true;
+    }
+}
+
+/**
+ * @brief Registers [callback] on [hookMethod], installing the trampoline first if the method is not
+ * hooked yet. The caller holds an EpochDomain::Guard.
+ */
+bool HookOne(JNIEnv *env, bool useModernApi, jobject hookMethod, const HookerInfo &hooker,
+             jint priority, jobject callback, jint owner) {
+    const PendingHook hook{static_cast<bool>(useModernApi), callback, priority, owner};
+    return HookCallbacks(env, hookMethod, hooker, {&hook, 1});
+}
+
+/**
+ * @struct DeferredHook
+ * @brief A hookMethod request on a class that was not initialized yet, held until its batch is
+ * installed. References are global.
+ */
+struct DeferredHook {
+    jmethodID target;
+    jobject method;
+    const HookerInfo *hooker;
+    PendingHook hook;
+    pid_t thread;  // Whose window queued it; that window installs it when it closes.
+};
+
+// Requests are only deferred while a window opened by beginDeferredHooks is open on the thread
+// making them. Every other thread hooks as usual meanwhile.
+thread_local int defer_depth = 0;
+std::mutex deferred_lock;
+std::vector<DeferredHook> deferred_hooks;  // Under deferred_lock.
+// The callbacks of queued requests that could not be installed, global references, held for the
+// window that queued them to report when it closes. Under deferred_lock.
+std::vector<std::pair<pid_t, jobject>> dropped_hooks;
+// Mirrors deferred_hooks.size(), so the paths that have to install a method's pending hooks first
+// pay a relaxed load when nothing is pending, which is nearly always.
+std::atomic<size_t> deferred_count{0};
+
+/**
+ * @brief Whether [cls] has finished initializing, and [unknown] where that cannot be told.
+ *
+ * Reads the status ART keeps in Class.status, whose top four bits have been the ClassStatus since
+ * Android 9.
+ */
+bool IsInitialized(JNIEnv *env, jclass cls, bool unknown) {
+    constexpr uint32_t kInitialized = 14;  // ClassStatus::kInitialized; 15 is visibly so.
+    static const bool supported = android_get_device_api_level() >= __ANDROID_API_P__;
+    static auto *const status = [env] {
+        auto field = env->GetFieldID(env->FindClass("java/lang/Class"), "status", "I");
+        if (!field) env->ExceptionClear();
+        return field;
+    }();
+    if (!supported || !status) return unknown;
+    auto value = static_cast<uint32_t>(env->GetIntField(cls, status));
+    return (value >> 28) >= kInitialized;
+}
+
+/**
+ * @brief Whether the declaring class of [executable] has finished initializing. Where that cannot
+ * be relied on the answer is yes, which only means the hook is installed right away.
+ */
+bool IsClassInitialized(JNIEnv *env, jobject executable) {
+    auto declaring_class = env->CallObjectMethod(executable, get_declaring_class);
+    if (!declaring_class) {
+        env->ExceptionClear();
+        return true;
+    }
+    bool initialized = IsInitialized(env, static_cast<jclass>(declaring_class), true);
+    env->DeleteLocalRef(declaring_class);
+    return initialized;
+}
+
+/**
+ * @brief Queues [hook] on [hookMethod] instead of installing it, when this thread has a deferral
+ * window open and the method's class has not been initialized yet.
+ *
+ * That is no promise the class stays so until the window closes: another thread may initialize it
+ * and call the method meanwhile, and those calls run without the hook. InstallDeferredHooks logs
+ * every method that happened to. Nor is it a promise the hook goes in: hookMethod has already
+ * answered yes, so a request that fails to install is handed back by endDeferredHooks instead.
+ *
+ * @return false when the request has to be installed now.
+ */
+bool DeferHook(JNIEnv *env, jobject hookMethod, const HookerInfo &hooker, const PendingHook &hook) {
+    if (defer_depth == 0) return false;
+    auto target = env->FromReflectedMethod(hookMethod);
+    if (!target || IsClassInitialized(env, hookMethod)) return false;
+
+    auto callback = hook.callback ? env->NewGlobalRef(hook.callback) : nullptr;
+    std::lock_guard lk(deferred_lock);
+    deferred_hooks.push_back(DeferredHook{target, env->NewGlobalRef(hookMethod), &hooker,
+                                          {hook.modern, callback, hook.priority, hook.owner},
+                                          gettid()});
+    deferred_count.store(deferred_hooks.size(), std::memory_order_release);
+    return true;
+}
+
+/**
+ * @brief Installs the deferred hooks on [target], or all of those the window of [thread] queued
+ * when it is null, and returns how many callbacks were registered.
+ *
+ * Requests on the same method go in together: one trampoline, one lock of the item and one
+ * publication of its snapshot, however many modules asked for it. Their order is kept, so equal
+ * priorities end up as they would have had nothing been deferred.
+ *
+ * A method whose class has been initialized by now may have run while it waited, without these
+ * hooks. That is logged, as it is the one thing deferral can get wrong.
+ *
+ * Requests that cannot be installed are set aside in dropped_hooks for the window that queued them,
+ * whichever thread happens to install them.
+ */
+jint InstallDeferredHooks(JNIEnv *env, jmethodID target = nullptr, pid_t thread = 0) {
+    if (deferred_count.load(std::memory_order_acquire) == 0) return 0;
+
+    std::vector<DeferredHook> batch;
+    {
+        std::lock_guard lk(deferred_lock);
+        auto split = std::stable_partition(
+            deferred_hooks.begin(), deferred_hooks.end(), [target, thread](const auto &deferred) {
+                return target ? deferred.target != target : deferred.thread != thread;
+            });
+        batch.assign(std::make_move_iterator(split), std::make_move_iterator(deferred_hooks.end()));
+        deferred_hooks.erase(split, deferred_hooks.end());
+        deferred_count.store(deferred_hooks.size(), std::memory_order_release);
+    }
+    if (batch.empty()) return 0;
+
+    std::stable_sort(batch.begin(), batch.end(), [](const auto &a, const auto &b) {
+        return std::tie(a.target, a.hooker) < std::tie(b.target, b.hooker);
+    });
+
+    jint installed = 0;
+    std::vector<PendingHook> group;
+    EpochDomain::Guard guard;
+    for (size_t begin = 0, end; begin < batch.size(); begin = end) {
+        group.clear();
+        for (end = begin; end < batch.size() && batch[end].target == batch[begin].target &&
+                          batch[end].hooker == batch[begin].hooker;
+             ++end) {
+            group.push_back(batch[end].hook);
+        }
+        const bool initialized = IsClassInitialized(env, batch[begin].method);
+        const bool hooked = HookCallbacks(env, batch[begin].method, *batch[begin].hooker, group);
+        if (hooked) installed += static_cast<jint>(group.size());
+        if (!initialized && hooked) continue;
+
+        auto name = static_cast<jstring>(
+            env->CallObjectMethod(batch[begin].method, to_string_method));
+        if (!name) env->ExceptionClear();
+        {
+            lsplant::JUTFString chars(env, name, "a method");
+            if (!hooked) {
+                LOGE("Deferred hooks on {} could not be installed: {} callback(s) dropped",
+                     chars.get(), group.size());
+            } else {
+                LOGW("{} was initialized before its deferred hooks went in; calls made in "
+                     "between ran without them",
+                     chars.get());
+            }
+        }
+        if (name) env->DeleteLocalRef(name);
+        if (hooked) continue;
+
+        std::lock_guard lk(deferred_lock);
+        for (size_t i = begin; i < end; ++i) {
+            if (auto &callback = batch[i].hook.callback) {
+                dropped_hooks.emplace_back(batch[i].thread, std::exchange(callback, nullptr));
+            }
+        }
+    }
+    for (const auto &deferred : batch) {
+        env->DeleteGlobalRef(deferred.method);
+        if (deferred.hook.callback) env->DeleteGlobalRef(deferred.hook.callback);
+    }
+    return installed;
+}
+
+/**
+ * @struct BoxType
+ * @brief One primitive type together with its wrapper class, as far as moving values between an
+ * Object[] and a jvalue needs them.
+ */
+struct BoxType {
+    char shorty;
+    jclass primitive = nullptr;    // The primitive's Class, e.g. int.class. Global reference.
+    jclass box = nullptr;          // The wrapper class, e.g. Integer. Global reference.
+    jfieldID value = nullptr;      // The wrapper's private `value` field.
+    jmethodID value_of = nullptr;  // The wrapper's static valueOf, which keeps the box caches.
+};
+
+/**
+ * @struct Boxing
+ * @brief Process-wide JNI handles for unboxing arguments and boxing results.
+ *
+ * An argument of exactly the parameter's wrapper type, which is nearly always what callers pass,
+ * is read straight from its `value` field. Anything else takes the lenient reflection-like path
+ * through Number and Character.
+ */
+struct Boxing {
+    BoxType types[8] = {{'Z'}, {'B'}, {'C'}, {'S'}, {'I'}, {'J'}, {'F'}, {'D'}};
+    jclass void_type = nullptr;
+    jclass number = nullptr;
+    jclass ite = nullptr;
+    jmethodID ite_init = nullptr;
+    jmethodID ite_get_cause = nullptr;
+    jmethodID int_value = nullptr, long_value = nullptr, float_value = nullptr,
+              double_value = nullptr, short_value = nullptr, byte_value = nullptr;
+    jobject boolean_true = nullptr, boolean_false = nullptr;
+
+    explicit Boxing(JNIEnv *env) {
+        constexpr const char *kBoxes[] = {"java/lang/Boolean", "java/lang/Byte",
+                                          "java/lang/Character", "java/lang/Short",
+                                          "java/lang/Integer", "java/lang/Long",
+                                          "java/lang/Float", "java/lang/Double"};
+        for (size_t i = 0; i < std::size(types); ++i) {
+            auto &type = types[i];
+            const char signature[] = {type.shorty, '\0'};
+            auto box = env->FindClass(kBoxes[i]);
+            type.box = static_cast<jclass>(env->NewGlobalRef(box));
+            type.primitive = static_cast<jclass>(env->NewGlobalRef(env->GetStaticObjectField(
+                box, env->GetStaticFieldID(box, "TYPE", "Ljava/lang/Class;"))));
+            type.value = env->GetFieldID(box, "value", signature);
+            type.value_of = env->GetStaticMethodID(
+                box, "valueOf", (std::string("(") + type.shorty + ")L" + kBoxes[i] + ";").c_str());
+            env->DeleteLocalRef(box);
+        }
+        auto void_box = env->FindClass("java/lang/Void");
+        void_type = static_cast<jclass>(env->NewGlobalRef(env->GetStaticObjectField(
+            void_box, env->GetStaticFieldID(void_box, "TYPE", "Ljava/lang/Class;"))));
+        number = static_cast<jclass>(env->NewGlobalRef(env->FindClass("java/lang/Number")));
+        ite = static_cast<jclass>(
+            env->NewGlobalRef(env->FindClass("java/lang/reflect/InvocationTargetException")));
+        ite_init = env->GetMethodID(ite, "<init>", "(Ljava/lang/Throwable;)V");
+        ite_get_cause = env->GetMethodID(ite, "getCause", "()Ljava/lang/Throwable;");
+        int_value = env->GetMethodID(number, "intValue", "()I");
+        long_value = env->GetMethodID(number, "longValue", "()J");
+        float_value = env->GetMethodID(number, "floatValue", "()F");
+        double_value = env->GetMethodID(number, "doubleValue", "()D");
+        short_value = env->GetMethodID(number, "shortValue", "()S");
+        byte_value = env->GetMethodID(number, "byteValue", "()B");
+        auto boolean = For('Z').box;
+        boolean_true = env->NewGlobalRef(env->GetStaticObjectField(
+            boolean, env->GetStaticFieldID(boolean, "TRUE", "Ljava/lang/Boolean;")));
+        boolean_false = env->NewGlobalRef(env->GetStaticObjectField(
+            boolean, env->GetStaticFieldID(boolean, "FALSE", "Ljava/lang/Boolean;")));
+    }
+
+    const BoxType &For(char shorty) const {
+        return *std::find_if(std::begin(types), std::end(types),
+                             [shorty](const auto &type) { return type.shorty == shorty; });
+    }
+
+    static const Boxing &Get() { return *instance; }
+
+    // Built by RegisterHookBridge, before anything can be hooked, so that hooked calls only read
+    // it and never resolve classes on their way through.
+    inline static const Boxing *instance = nullptr;
+};
+
+bool CallbackFilter::Matches(JNIEnv *env, jobject thiz, jobjectArray args,
+                             jsize first_arg) const {
+    const jsize arg_count = env->GetArrayLength(args) - first_arg;
+    for (const auto &clause : clauses) {
+        if (clause.kind == kThisInstanceOf) {
+            if (!thiz || !env->IsInstanceOf(thiz, static_cast<jclass>(clause.constant))) {
+                return false;
+            }
+            continue;
+        }
+        // A clause on a parameter the method does not have can never hold.
+        if (clause.index >= arg_count) return false;
+        auto arg = env->GetObjectArrayElement(args, first_arg + clause.index);
+        bool holds = false;
+        switch (clause.kind) {
+        case kArgIsNull:
+            holds = arg == nullptr;
+            break;
+        case kArgInstanceOf:
+            holds = arg && env->IsInstanceOf(arg, static_cast<jclass>(clause.constant));
+            break;
+        case kArgEqualsInt: {
+            const auto &integer = Boxing::Get().For('I');
+            holds = arg && env->IsInstanceOf(arg, integer.box) &&
+                    env->GetIntField(arg, integer.value) == clause.int_value;
+            break;
+        }
+        case kArgEqualsString: {
+            if (!arg || !env->IsInstanceOf(arg, string_class)) break;
+            auto string = static_cast<jstring>(arg);
+            const auto length = static_cast<size_t>(env->GetStringLength(string));
+            if (length != clause.string.size()) break;
+            // Compared in place, so a mismatch on a long string costs no copy of it.
+            const jchar *chars = env->GetStringCritical(string, nullptr);
+            if (!chars) break;
+            holds = std::equal(clause.string.begin(), clause.string.end(), chars);
+            env->ReleaseStringCritical(string, chars);
+            break;
+        }
+        case kThisInstanceOf:
+            break;
+        }
+        if (arg) env->DeleteLocalRef(arg);
+        if (!holds) return false;
+    }
+    return true;
+}
+
+/**
+ * @struct InvokePlan
+ * @brief What it takes to call one method through JNI, worked out from its reflected form once.
+ *
+ * The shorty used to be rebuilt in Java on every invokeSpecial call, walking the parameter types
+ * and allocating a char array each time, and invokeOriginal went through Method.invoke, which
+ * repeats the same checks in the runtime on every call.
+ */
+struct InvokePlan {
+    std::string shorty;     // Return type first, then one character per parameter.
+    jclass declaring_class; // Global reference.
+    bool is_static;
+    bool is_constructor;
+};
+
+// Plans by target method. Never erased: a method's signature does not change, and a plan is small.
+SharedHashMap<jmethodID, std::unique_ptr<InvokePlan>> invoke_plans;
+
+std::unique_ptr<InvokePlan> BuildInvokePlan(JNIEnv *env, jobject executable) {
+    constexpr jint kAccStatic = 0x0008;
+
+    const auto &boxing = Boxing::Get();
+    auto shorty_of = [&](jclass type) {
+        if (env->IsSameObject(type, boxing.void_type)) return 'V';
+        for (const auto &box : boxing.types) {
+            if (env->IsSameObject(type, box.primitive)) return box.shorty;
+        }
+        return 'L';
+    };
+
+    auto plan = std::make_unique<InvokePlan>();
+    plan->is_constructor = env->IsInstanceOf(executable, method_class) == JNI_FALSE;
+    plan->is_static = (env->CallIntMethod(executable, get_modifiers) & kAccStatic) != 0;
+
+    if (plan->is_constructor) {
+        plan->shorty.push_back('V');
+    } else {
+        auto return_type = static_cast<jclass>(env->CallObjectMethod(executable, get_return_type));
+        if (!return_type) return nullptr;
+        plan->shorty.push_back(shorty_of(return_type));
+        env->DeleteLocalRef(return_type);
+    }
+
+    auto parameter_types =
+        static_cast<jobjectArray>(env->CallObjectMethod(executable, get_parameter_types));
+    if (!parameter_types) return nullptr;
+    const jsize parameter_count = env->GetArrayLength(parameter_types);
+    for (jsize i = 0; i < parameter_count; ++i) {
+        auto type = static_cast<jclass>(env->GetObjectArrayElement(parameter_types, i));
+        plan->shorty.push_back(shorty_of(type));
+        env->DeleteLocalRef(type);
+    }
+    env->DeleteLocalRef(parameter_types);
+
+    auto declaring_class = env->CallObjectMethod(executable, get_declaring_class);
+    if (!declaring_class) return nullptr;
+    plan->declaring_class = static_cast<jclass>(env->NewGlobalRef(declaring_class));
+    env->DeleteLocalRef(declaring_class);
+    return plan;
+}
+
+/**
+ * @brief The plan for [target], built from [executable] on first use.
+ * @return nullptr with an exception pending when reflection on [executable] failed.
+ */
+const InvokePlan *GetInvokePlan(JNIEnv *env, jmethodID target, jobject executable) {
+    const InvokePlan *plan = nullptr;
+    invoke_plans.if_contains(target, [&plan](const auto &it) { plan = it.second.get(); });
+    if (plan) return plan;
+
+    auto built = BuildInvokePlan(env, executable);
+    if (!built) return nullptr;
+    invoke_plans.lazy_emplace_l(
+        target, [&plan](auto &it) { plan = it.second.get(); },
+        [&](const auto &ctor) {
+            plan = built.get();
+            ctor(target, std::move(built));
+        });
+    // Another thread published the same plan first.
+    if (built) env->DeleteGlobalRef(built->declaring_class);
+    return plan;
+}
+
+/**
+ * @brief How Invoke calls the method: through the vtable, exactly the given implementation, or as a
+ * static method.
+ */
+enum class Dispatch { kVirtual, kNonvirtual, kStatic };
+
+/**
+ * @brief Unboxes one argument for a primitive parameter, mirroring what reflection accepts.
+ * @return false with an IllegalArgumentException pending when [element] does not fit.
+ */
+bool Unbox(JNIEnv *env, const Boxing &boxing, char type, jobject element, jvalue &value) {
+    const auto &box = boxing.For(type);
+    // The argument is nearly always the parameter's own wrapper: read it without a call.
+    if (env->IsInstanceOf(element, box.box)) {
+        switch (type) {
+        case 'Z':
+            value.z = env->GetBooleanField(element, box.value);
+            break;
+        case 'B':
+            value.b = env->GetByteField(element, box.value);
+            break;
+        case 'C':
+            value.c = env->GetCharField(element, box.value);
+            break;
+        case 'S':
+            value.s = env->GetShortField(element, box.value);
+            break;
+        case 'I':
+            value.i = env->GetIntField(element, box.value);
+            break;
+        case 'J':
+            value.j = env->GetLongField(element, box.value);
+            break;
+        case 'F':
+            value.f = env->GetFloatField(element, box.value);
+            break;
+        case 'D':
+            value.d = env->GetDoubleField(element, box.value);
+            break;
+        }
+        return true;
+    }
+
+    if (type == 'Z' || type == 'C') {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
+                      type == 'Z' ? "Expected Boolean" : "Expected Character");
+        return false;
+    }
+
+    // A Character passed to a numeric parameter is widened from its value.
+    const auto &character = boxing.For('C');
+    if (env->IsInstanceOf(element, character.box)) {
+        jchar c = env->GetCharField(element, character.value);
+        switch (type) {
+        case 'B':
+            value.b = static_cast<jbyte>(c);
+            break;
+        case 'S':
+            value.s = static_cast<jshort>(c);
+            break;
+        case 'I':
+            value.i = c;
+            break;
+        case 'J':
+            value.j = c;
+            break;
+        case 'F':
+            value.f = c;
+            break;
+        case 'D':
+            value.d = c;
+            break;
+        }
+        return true;
+    }
+
+    if (!env->IsInstanceOf(element, boxing.number)) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
+                      "Expected Number or Character");
+        return false;
+    }
+    switch (type) {
+    case 'B':
+        value.b = env->CallByteMethod(element, boxing.byte_value);
+        break;
+    case 'S':
+        value.s = env->CallShortMethod(element, boxing.short_value);
+        break;
+    case 'I':
+        value.i = env->CallIntMethod(element, boxing.int_value);
+        break;
+    case 'J':
+        value.j = env->CallLongMethod(element, boxing.long_value);
+        break;
+    case 'F':
+        value.f = env->CallFloatMethod(element, boxing.float_value);
+        break;
+    case 'D':
+        value.d = env->CallDoubleMethod(element, boxing.double_value);
+        break;
+    }
+    return !env->ExceptionCheck();
+}
+
+/**
+ * @brief Boxes [value] of shorty [type] the way reflection returns it: nullptr for void, the
+ * reference itself for 'L'.
+ */
+jobject Box(JNIEnv *env, const Boxing &boxing, char type, const jvalue &value) {
+    switch (type) {
+    case 'V':
+        return nullptr;
+    case 'L':
+        return value.l;
+    case 'Z':
+        return env->NewLocalRef(value.z ? boxing.boolean_true : boxing.boolean_false);
+    case 'B':
+        return env->CallStaticObjectMethod(boxing.For('B').box, boxing.For('B').value_of,
+                                           value.b);
+    case 'C':
+        return env->CallStaticObjectMethod(boxing.For('C').box, boxing.For('C').value_of,
+                                           value.c);
+    case 'S':
+        return env->CallStaticObjectMethod(boxing.For('S').box, boxing.For('S').value_of,
+                                           value.s);
+    case 'I':
+        return env->CallStaticObjectMethod(boxing.For('I').box, boxing.For('I').value_of,
+                                           value.i);
+    case 'J':
+        return env->CallStaticObjectMethod(boxing.For('J').box, boxing.For('J').value_of,
+                                           value.j);
+    case 'F':
+        return env->CallStaticObjectMethod(boxing.For('F').box, boxing.For('F').value_of,
+                                           value.f);
+    case 'D':
+        return env->CallStaticObjectMethod(boxing.For('D').box, boxing.For('D').value_of,
+                                           value.d);
+    }
+    return nullptr;
+}
+
+/**
+ * @class ObserverQueue
+ * @brief The bounded queue observer captures go through, from hooked calls to the thread that
+ * delivers them.
+ *
+ * A ring of fixed slots after Vyukov's bounded queue: a producer claims a slot with one CAS on the
+ * tail and publishes it with a store to the slot's sequence, so a capture takes no lock and
+ * allocates nothing. When the ring is full the capture is dropped and counted; a hooked thread
+ * never waits for observers, and a stalled observer cannot grow the queue without bound.
+ *
+ * The one consumer is the Java thread parked in HookBridge.runObservers. It sleeps on the futex
+ * behind [wake_] only when the ring is empty, and only then do producers pay for waking it.
+ *
+ * The bound is kCapacity captures for the whole process, in one array of about 100 KiB allocated
+ * with the queue. Once that many wait, further ones are dropped until the observer thread catches
+ * up; observerStats reports how many.
+ */
+class ObserverQueue {
+public:
+    static constexpr size_t kCapacity = 1024;
+
+    struct Slot {
+        std::atomic<size_t> sequence;
+        const ObserverSpec *spec;  // Holds a reference until delivered.
+        uint8_t count;
+        char types[ObserverSpec::kMaxCaptures];
+        jvalue values[ObserverSpec::kMaxCaptures];  // References are global.
+    };
+
+    static ObserverQueue &Instance() {
+        static ObserverQueue queue;
+        return queue;
+    }
+
+    /// Claims the next free slot and its [position], or counts a drop and returns nullptr.
+    Slot *Claim(size_t &position) {
+        position = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            auto &slot = slots_[position & (kCapacity - 1)];
+            const auto sequence = slot.sequence.load(std::memory_order_acquire);
+            const auto lag = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+            if (lag == 0) {
+                if (tail_.compare_exchange_weak(position, position + 1,
+                                                std::memory_order_relaxed)) {
+                    return &slot;
+                }
+            } else if (lag < 0) {
+                // The slot still holds a capture from one lap ago: the ring is full.
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return nullptr;
+            } else {
+                position = tail_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Hands a filled [slot], claimed at [position], to the consumer.
+    void Publish(Slot *slot, size_t position) {
+        slot->sequence.store(position + 1, std::memory_order_release);
+        // Pairs with the consumer's store to sleeping_: either it sees this slot before it
+        // sleeps, or this sees it sleeping.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping_.load(std::memory_order_relaxed)) {
+            wake_.fetch_add(1, std::memory_order_relaxed);
+            wake_.notify_one();
+        }
+    }
+
+    /**
+     * @brief Delivers captures on the calling thread for as long as the process lives.
+     * @return At once, when another thread is already the consumer.
+     */
+    void Drain(JNIEnv *env) {
+        if (draining_.exchange(true, std::memory_order_acquire)) return;
+        for (size_t head = 0;; ++head) {
+            auto &slot = slots_[head & (kCapacity - 1)];
+            while (slot.sequence.load(std::memory_order_acquire) != head + 1) {
+                const auto ticket = wake_.load(std::memory_order_relaxed);
+                sleeping_.store(true, std::memory_order_seq_cst);
+                if (slot.sequence.load(std::memory_order_seq_cst) != head + 1) {
+                    wake_.wait(ticket, std::memory_order_relaxed);
+                }
+                sleeping_.store(false, std::memory_order_relaxed);
+            }
+            Deliver(env, slot);
+            slot.sequence.store(head + kCapacity, std::memory_order_release);
+        }
+    }
+
+    uint64_t Dropped() const { return dropped_.load(std::memory_order_relaxed); }
+    uint64_t Delivered() const { return delivered_.load(std::memory_order_relaxed); }
+
+private:
+    ObserverQueue() : slots_(new Slot[kCapacity]) {
+        for (size_t i = 0; i < kCapacity; ++i) {
+            slots_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    void Deliver(JNIEnv *env, Slot &slot) {
+        const auto &boxing = Boxing::Get();
+        if (env->PushLocalFrame(slot.count * 2 + 4) == JNI_OK) {
+            auto args = env->NewObjectArray(slot.count, object_class, nullptr);
+            for (uint8_t i = 0; args && i < slot.count; ++i) {
+                auto value = Box(env, boxing, slot.types[i], slot.values[i]);
+                env->SetObjectArrayElement(args, i, value);
+            }
+            if (args) env->CallVoidMethod(slot.spec->receiver, slot.spec->deliver, args);
+            env->PopLocalFrame(nullptr);
+        }
+        // The Java side reports what an observer throws, so this is only ever an OOM.
+        if (env->ExceptionCheck()) env->ExceptionClear();
+
+        for (uint8_t i = 0; i < slot.count; ++i) {
+            if (slot.types[i] == 'L' && slot.values[i].l) env->DeleteGlobalRef(slot.values[i].l);
+        }
+        slot.spec->Release(env);
+        delivered_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    alignas(64) std::atomic<size_t> tail_{0};
+    alignas(64) std::atomic<bool> sleeping_{false};
+    std::atomic<uint32_t> wake_{0};
+    std::atomic<bool> draining_{false};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> delivered_{0};
+};
+
+void ObserverSpec::Capture(JNIEnv *env, jobject thiz, jobjectArray args, jsize first_arg) const {
+    auto &queue = ObserverQueue::Instance();
+    size_t position;
+    auto *slot = queue.Claim(position);
+    if (!slot) return;
+
+    const auto &boxing = Boxing::Get();
+    const jsize arg_count = env->GetArrayLength(args) - first_arg;
+    // The caller's EpochDomain::Guard keeps this alive until the slot holds its reference.
+    references.fetch_add(1, std::memory_order_relaxed);
+    slot->spec = this;
+    slot->count = static_cast<uint8_t>(captures.size());
+    for (size_t i = 0; i < captures.size(); ++i) {
+        const jint index = captures[i];
+        auto &value = slot->values[i];
+        value = {};
+        slot->types[i] = types[i];
+        if (index == kReceiver) {
+            slot->types[i] = 'L';
+            value.l = thiz ? env->NewGlobalRef(thiz) : nullptr;
+            continue;
+        }
+        auto element = index < arg_count ? env->GetObjectArrayElement(args, first_arg + index)
+                                         : nullptr;
+        if (types[i] == 'L') {
+            value.l = element ? env->NewGlobalRef(element) : nullptr;
+        } else if (!element || !Unbox(env, boxing, types[i], element, value)) {
+            // Never the case for what a trampoline boxed; delivered as null rather than garbage.
+            env->ExceptionClear();
+            slot->types[i] = 'L';
+            value.l = nullptr;
+        }
+        if (element) env->DeleteLocalRef(element);
+    }
+    queue.Publish(slot, position);
+}
+
+/**
+ * @class MemoTable
+ * @brief The results a memoizing hook has given, by the arguments it was given them for.
+ *
+ * A key is the bytes of the argument tuple, receiver first: primitives by value, strings by their
+ * UTF-16 contents and any other object by identity. An identity is hashed with identityHashCode
+ * and held weakly, so a remembered call keeps nothing alive and one whose object has been collected
+ * simply stops matching.
+ *
+ * Hooked calls read it from @FastNative methods, which must not block, so it takes no lock: a
+ * generation is a fixed open-addressed array of immutable entries, filled by CAS into empty slots
+ * and never edited. Clearing publishes an empty generation and retires the old one through the
+ * epoch domain.
+ *
+ * A generation holds at most kMaxEntries results, half its slots so probes stay short, which
+ * bounds a table per hooked method. The insert that finds it full sweeps it into a new
+ * generation: results whose identities have been collected are left behind, and so is every
+ * result when the survivors would fill more than half the new one. The old generation is retired
+ * like a cleared one, so only results that were dropped go with it.
+ */
+class MemoTable {
+public:
+    static constexpr size_t kSlots = 512;
+    static constexpr size_t kMaxEntries = kSlots / 2;
+
+    struct Key {
+        std::string bytes;
+        std::vector<jobject> identities;  // Local references, or weak ones once noted.
+        uint64_t generation = 0;
+
+        void Release(JNIEnv *env, bool weak) {
+            for (auto ref : identities) {
+                if (weak) {
+                    env->DeleteWeakGlobalRef(ref);
+                } else {
+                    env->DeleteLocalRef(ref);
+                }
+            }
+            identities.clear();
+        }
+    };
+
+    explicit MemoTable(std::string shorty)
+        : shorty_(std::move(shorty)), current_(new Generation{0}) {}
+
+    /**
+     * @brief Builds the key of a call with [args], receiver first unless [is_static].
+     * @return false when [args] does not fit the method, which leaves the call unmemoized.
+     */
+    bool KeyOf(JNIEnv *env, jobjectArray args, bool is_static, Key &key) const {
+        const auto &boxing = Boxing::Get();
+        const jsize first = is_static ? 0 : 1;
+        const jsize count = env->GetArrayLength(args);
+        if (static_cast<size_t>(count - first) != shorty_.size() - 1) return false;
+        auto append = [&key](const auto &value) {
+            key.bytes.append(reinterpret_cast<const char *>(&value), sizeof(value));
+        };
+        for (jsize i = 0; i < count; ++i) {
+            const char type = i < first ? 'L' : shorty_[i - first + 1];
+            auto element = env->GetObjectArrayElement(args, i);
+            if (!element) {
+                key.bytes.push_back('N');
+            } else if (type != 'L') {
+                jvalue value{};
+                if (!Unbox(env, boxing, type, element, value)) {
+                    env->ExceptionClear();
+                    env->DeleteLocalRef(element);
+                    key.Release(env, false);
+                    return false;
+                }
+                key.bytes.push_back(type);
+                append(value.j);
+            } else if (i >= first && env->IsInstanceOf(element, string_class)) {
+                auto string = static_cast<jstring>(element);
+                const jsize length = env->GetStringLength(string);
+                key.bytes.push_back('S');
+                append(length);
+                const auto offset = key.bytes.size();
+                key.bytes.resize(offset + static_cast<size_t>(length) * sizeof(jchar));
+                env->GetStringRegion(string, 0, length,
+                                     reinterpret_cast<jchar *>(key.bytes.data() + offset));
+            } else {
+                key.bytes.push_back('O');
+                append(env->CallStaticIntMethod(system_class, identity_hash_code, element));
+                key.identities.push_back(element);
+                continue;
+            }
+            env->DeleteLocalRef(element);
+        }
+        return true;
+    }
+
+    /**
+     * @brief The hit array remembered for [key], or nullptr; either way [key] is stamped with the
+     * generation it was looked up in. The caller holds an EpochDomain::Guard.
+     */
+    jobjectArray Find(JNIEnv *env, Key &key) const {
+        auto *generation = current_.load(std::memory_order_acquire);
+        key.generation = generation->number;
+        const auto hash = std::hash<std::string>{}(key.bytes);
+        for (size_t i = 0; i < kSlots; ++i) {
+            auto *entry = generation->slots[(hash + i) & (kSlots - 1)].load(
+                std::memory_order_acquire);
+            if (!entry) return nullptr;
+            if (entry->hash != hash || entry->bytes != key.bytes ||
+                !std::equal(entry->identities.begin(), entry->identities.end(),
+                            key.identities.begin(), key.identities.end(),
+                            [env](jobject a, jobject b) { return env->IsSameObject(a, b); })) {
+                continue;
+            }
+            return static_cast<jobjectArray>(env->NewLocalRef(entry->hit));
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Remembers [result] for [key], whose identities are weak references it takes over,
+     * unless the table has been cleared since [key] was looked up or is full. The caller holds an
+     * EpochDomain::Guard.
+     */
+    void Insert(JNIEnv *env, Key &&key, jobject result) {
+        auto *generation = current_.load(std::memory_order_acquire);
+        if (generation->number == key.generation &&
+            generation->size.load(std::memory_order_relaxed) >= kMaxEntries) {
+            generation = Sweep(env, generation);
+        }
+        if (!generation || generation->number != key.generation ||
+            generation->size.load(std::memory_order_relaxed) >= kMaxEntries) {
+            key.Release(env, true);
+            return;
+        }
+        // What a hit hands back: the shape of a snapshot, so the hooker needs no second call.
+        auto inner = env->NewObjectArray(1, object_class, result);
+        auto outer = inner ? env->NewObjectArray(1, object_array_class, inner) : nullptr;
+        auto *entry = outer ? new Entry{std::hash<std::string>{}(key.bytes), std::move(key.bytes),
+                                        std::move(key.identities),
+                                        static_cast<jobjectArray>(env->NewGlobalRef(outer))}
+                            : nullptr;
+        if (inner) env->DeleteLocalRef(inner);
+        if (outer) env->DeleteLocalRef(outer);
+        if (!entry) {
+            env->ExceptionClear();
+            key.Release(env, true);
+            return;
+        }
+        generation->size.fetch_add(1, std::memory_order_relaxed);
+        for (size_t i = 0; i < kSlots; ++i) {
+            const Entry *empty = nullptr;
+            if (generation->slots[(entry->hash + i) & (kSlots - 1)].compare_exchange_strong(
+                    empty, entry, std::memory_order_acq_rel)) {
+                return;
+            }
+        }
+        Entry::Delete(env, entry);
+    }
+
+    /// Starts an empty generation. @return How many results the previous one held.
+    size_t Clear(JNIEnv *env) {
+        auto *fresh = new Generation{next_number_.fetch_add(1, std::memory_order_relaxed) + 1};
+        auto *previous = current_.exchange(fresh, std::memory_order_acq_rel);
+        const auto size = std::min(previous->size.load(std::memory_order_relaxed), kMaxEntries);
+        EpochDomain::Instance().Retire(env, previous, &Generation::Delete);
+        return size;
+    }
+
+    static void Delete(JNIEnv *env, MemoTable *table) {
+        Generation::Delete(env, table->current_.load(std::memory_order_relaxed));
+        delete table;
+    }
+
+private:
+    struct Entry {
+        size_t hash;
+        std::string bytes;
+        std::vector<jobject> identities;  // Weak global references.
+        jobjectArray hit;                 // Global reference to Object[][]{{result}}.
+
+        bool Alive(JNIEnv *env) const {
+            return std::none_of(identities.begin(), identities.end(),
+                                [env](jobject ref) { return env->IsSameObject(ref, nullptr); });
+        }
+
+        static void Delete(JNIEnv *env, const Entry *entry) {
+            for (auto ref : entry->identities) env->DeleteWeakGlobalRef(ref);
+            env->DeleteGlobalRef(entry->hit);
+            delete entry;
+        }
+    };
+
+    struct Generation {
+        uint64_t number;
+        std::atomic<size_t> size{0};
+        std::atomic<const Entry *> slots[kSlots]{};
+
+        static void Delete(JNIEnv *env, void *ptr) {
+            auto *generation = static_cast<Generation *>(ptr);
+            for (auto &slot : generation->slots) {
+                if (auto *entry = slot.load(std::memory_order_relaxed)) Entry::Delete(env, entry);
+            }
+            delete generation;
+        }
+    };
+
+    /**
+     * @brief Replaces the full [full] with a generation of the same number holding its live
+     * entries, or none of them when they are too many. @return The new generation, or nullptr
+     * when another thread replaced [full] first.
+     *
+     * Entries move by pointer. A moved one is taken out of [full], whose readers then miss it
+     * rather than reach it twice, and the rest stay behind for the epoch domain to free.
+     */
+    Generation *Sweep(JNIEnv *env, Generation *full) {
+        auto *fresh = new Generation{full->number};
+        if (!current_.compare_exchange_strong(full, fresh, std::memory_order_acq_rel)) {
+            delete fresh;
+            return nullptr;
+        }
+        size_t live = 0;
+        for (auto &slot : full->slots) {
+            auto *entry = slot.load(std::memory_order_acquire);
+            if (entry && entry->Alive(env)) ++live;
+        }
+        if (live <= kMaxEntries / 2) {
+            for (auto &slot : full->slots) {
+                auto *entry = slot.load(std::memory_order_acquire);
+                if (!entry || !entry->Alive(env)) continue;
+                slot.store(nullptr, std::memory_order_release);
+                // Inserts stop at kMaxEntries, so half the slots are room to spare for these.
+                for (size_t i = 0; i < kSlots; ++i) {
+                    const Entry *empty = nullptr;
+                    if (fresh->slots[(entry->hash + i) & (kSlots - 1)].compare_exchange_strong(
+                            empty, entry, std::memory_order_acq_rel)) {
+                        fresh->size.fetch_add(1, std::memory_order_relaxed);
+                        break;
+                    }
+                }
+            }
+        }
+        EpochDomain::Instance().Retire(env, full, &Generation::Delete);
+        return fresh;
+    }
+
+    const std::string shorty_;
+    std::atomic<Generation *> current_;
+    std::atomic<uint64_t> next_number_{0};
+};
+
+/**
+ * @brief The memoized calls whose Java dispatch is running on this thread, innermost last.
+ *
+ * Pushed by a lookup that found nothing and popped when the call leaves, so the result can be
+ * filed under the key built on the way in. A call that is not to be remembered still takes its
+ * place, with [remember] false, so that pushes and pops pair up.
+ */
+struct PendingMemo {
+    const HookCell *cell;
+    const MemoTable *table;  // Where the key was looked up; only ever compared.
+    bool remember;
+    MemoTable::Key key;
+};
+thread_local std::vector<PendingMemo> memoizing;
+
+jobjectArray HookItem::LookupMemo(JNIEnv *env, jobjectArray args, bool is_static) {
+    auto *table = memo.load(std::memory_order_acquire);
+    PendingMemo pending{cell, table, false, {}};
+    if (table && table->KeyOf(env, args, is_static, pending.key)) {
+        if (auto hit = table->Find(env, pending.key)) {
+            pending.key.Release(env, false);
+            return hit;
+        }
+        for (auto &ref : pending.key.identities) {
+            auto weak = env->NewWeakGlobalRef(ref);
+            env->DeleteLocalRef(ref);
+            ref = weak;
+        }
+        pending.remember = true;
+    }
+    memoizing.push_back(std::move(pending));
+    return nullptr;
+}
+
+void HookItem::SettleMemo(JNIEnv *env, bool dispatched, bool complete) {
+    if (memoizing.empty() || memoizing.back().cell != cell) return;
+    auto &pending = memoizing.back();
+    if (!dispatched || !complete) {
+        if (pending.remember) pending.key.Release(env, true);
+        pending.remember = false;
+    }
+    if (!dispatched) memoizing.pop_back();
+}
+
+void HookItem::RecordMemo(JNIEnv *env, const HookCell *cell, HookItem *hook_item,
+                          jobject result, bool returned) {
+    if (memoizing.empty() || memoizing.back().cell != cell) return;
+    auto pending = std::move(memoizing.back());
+    memoizing.pop_back();
+    if (!pending.remember) return;
+    auto *table = hook_item ? hook_item->memo.load(std::memory_order_acquire) : nullptr;
+    if (returned && table && table == pending.table) {
+        table->Insert(env, std::move(pending.key), result);
+    } else {
+        pending.key.Release(env, true);
+    }
+}
+
+void HookItem::EnableMemo(const std::string &shorty) {
+    if (!memo.load(std::memory_order_relaxed)) {
+        memo.store(new MemoTable(shorty), std::memory_order_release);
+    }
+}
+
+size_t HookItem::ClearMemo(JNIEnv *env) {
+    auto *table = memo.load(std::memory_order_acquire);
+    return table ? table->Clear(env) : 0;
+}
+
+void HookItem::DeleteMemo(JNIEnv *env, MemoTable *table) {
+    if (table) MemoTable::Delete(env, table);
+}
+
+/**
+ * @brief Calls [method] as described by [plan] with reflection's argument and exception semantics.
  *
- * It also manages a thread-safe "backup" object,
- * which is a handle to the original, un-hooked method.
+ * Arguments are unboxed into a stack-allocated jvalue array, the result is boxed the way
+ * Method.invoke boxes it, and an exception thrown by the callee comes out wrapped in an
+ * InvocationTargetException unless [wrap] is false. The arguments start at index [first] of
+ * [args], which lets a hooker pass the array its trampoline built, receiver and all, without
+ * unpacking it.
  */
-struct HookItem {
-    // Callbacks are stored in multimaps, keyed by priority.
-    // std::greater<> ensures that higher priority numbers are processed first.
-    std::multimap<jint, jobject, std::greater<>> legacy_callbacks;
-    std::multimap<jint, jobject, std::greater<>> modern_callbacks;
+jobject Invoke(JNIEnv *env, const InvokePlan &plan, jmethodID method, Dispatch dispatch, jclass cls,
+               jobject thiz, jobjectArray args, jsize first = 0, bool wrap = true) {
+    const auto &boxing = Boxing::Get();
+    const jsize param_len = static_cast<jsize>(plan.shorty.size()) - 1;
 
-private:
-    // The backup is an atomic jobject.
-    // This is crucial for thread safety during the initial hooking process.
-    // It can be in one of three states:
-    // - nullptr: The hook has not been initialized yet.
-    // - FAILED: The hook attempt failed.
-    // - A valid jobject: A handle to the original method.
-    std::atomic<jobject> backup{nullptr};
-    static_assert(decltype(backup)::is_always_lock_free);
-    // A sentinel value to indicate that the hooking process failed.
-    inline static jobject FAILED = reinterpret_cast<jobject>(std::numeric_limits<uintptr_t>::max());
+    // --- Argument & Receiver Validation ---
+    auto args_len = args != nullptr ? env->GetArrayLength(args) - first : 0;
+    if (args_len != param_len) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
+                      "args.length does not match parameter count");
+        return nullptr;
+    }
 
-public:
-    /**
-     * @brief Atomically and safely retrieves the backup method handle.
-     * If another thread is currently setting up the hook, this method will wait until
-     * the process is complete, to prevent race conditions.
-     */
-    jobject GetBackup() {
-        // Wait until the 'backup' atomic is no longer nullptr.
-        backup.wait(nullptr, std::memory_order_acquire);
-        if (auto bk = backup.load(std::memory_order_relaxed); bk != FAILED) {
-            return bk;
-        } else {
+    if (dispatch != Dispatch::kStatic) {
+        if (thiz == nullptr) {
+            env->ThrowNew(env->FindClass("java/lang/NullPointerException"), "null receiver");
+            return nullptr;
+        }
+        // Calling through JNI with a receiver of the wrong type is undefined rather than an error.
+        if (!env->IsInstanceOf(thiz, cls)) {
+            env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
+                          "Expected receiver of the declaring class");
             return nullptr;
         }
     }
 
-    /**
-     * @brief Atomically sets the backup method handle once after hooking.
-     * This method uses compare_exchange_strong to ensure it only sets the value once.
-     * After setting, it notifies any waiting threads.
-     */
-    void SetBackup(jobject newBackup) {
-        jobject null = nullptr;
-        // Attempt to transition from nullptr to the new backup (or FAILED).
-        // memory_order_acq_rel ensures memory synchronization
-        // with both waiting threads (acquire) and subsequent reads (release).
-        backup.compare_exchange_strong(null, newBackup ? newBackup : FAILED,
-                                       std::memory_order_acq_rel, std::memory_order_relaxed);
-        // Wake up all threads that were waiting in GetBackup().
-        backup.notify_all();
+    // Allocate jvalue array on the stack
+    jvalue *a = param_len > 0 ? static_cast<jvalue *>(alloca(param_len * sizeof(jvalue))) : nullptr;
+
+    // --- Safe Unboxing ---
+    for (jsize i = 0; i != param_len; ++i) {
+        jobject element = env->GetObjectArrayElement(args, first + i);
+        if (env->ExceptionCheck()) return nullptr;
+
+        char type = plan.shorty[i + 1];
+        if (type == 'L') {
+            // Reference arguments stay alive as local references until we return.
+            a[i].l = element;
+            continue;
+        }
+        if (element == nullptr) {
+            env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
+                          "null primitive argument");
+            return nullptr;
+        }
+        bool unboxed = Unbox(env, boxing, type, element, a[i]);
+        env->DeleteLocalRef(element);
+        if (!unboxed) return nullptr;
     }
-};
 
-// A type alias for a thread-safe parallel hash map.
-// This map is the central registry, mapping a method's ID to its HookItem.
-// It uses a std::shared_mutex to allow concurrent reads but exclusive writes.
-template <class K, class V, class Hash = phmap::priv::hash_default_hash<K>,
-          class Eq = phmap::priv::hash_default_eq<K>,
-          class Alloc = phmap::priv::Allocator<phmap::priv::Pair<const K, V>>, size_t N = 4>
-using SharedHashMap = phmap::parallel_flat_hash_map<K, V, Hash, Eq, Alloc, N, std::shared_mutex>;
+    // --- Invocation ---
+#define VECTOR_INVOKE_CASE(shorty_char, field, Type)                                      \
+    case shorty_char:                                                                     \
+        switch (dispatch) {                                                               \
+        case Dispatch::kStatic:                                                           \
+            ret_val.field = env->CallStatic##Type##MethodA(cls, method, a);               \
+            break;                                                                        \
+        case Dispatch::kVirtual:                                                          \
+            ret_val.field = env->Call##Type##MethodA(thiz, method, a);                    \
+            break;                                                                        \
+        case Dispatch::kNonvirtual:                                                       \
+            ret_val.field = env->CallNonvirtual##Type##MethodA(thiz, cls, method, a);     \
+            break;                                                                        \
+        }                                                                                 \
+        break;
 
-// The global map of all hooked methods.
-SharedHashMap<jmethodID, std::unique_ptr<HookItem>> hooked_methods;
+    jvalue ret_val{};
+    switch (plan.shorty[0]) {
+        VECTOR_INVOKE_CASE('Z', z, Boolean)
+        VECTOR_INVOKE_CASE('B', b, Byte)
+        VECTOR_INVOKE_CASE('C', c, Char)
+        VECTOR_INVOKE_CASE('S', s, Short)
+        VECTOR_INVOKE_CASE('I', i, Int)
+        VECTOR_INVOKE_CASE('J', j, Long)
+        VECTOR_INVOKE_CASE('F', f, Float)
+        VECTOR_INVOKE_CASE('D', d, Double)
+        VECTOR_INVOKE_CASE('L', l, Object)
+    default:
+        switch (dispatch) {
+        case Dispatch::kStatic:
+            env->CallStaticVoidMethodA(cls, method, a);
+            break;
+        case Dispatch::kVirtual:
+            env->CallVoidMethodA(thiz, method, a);
+            break;
+        case Dispatch::kNonvirtual:
+            env->CallNonvirtualVoidMethodA(thiz, cls, method, a);
+            break;
+        }
+        break;
+    }
+#undef VECTOR_INVOKE_CASE
 
-// Cached JNI method and field IDs for performance.
-jmethodID invoke = nullptr;
+    // --- Exception Wrapping ---
+    if (!wrap && env->ExceptionCheck()) return nullptr;
+    if (jthrowable target_exception = env->ExceptionOccurred()) {
+        env->ExceptionClear();
+        jobject ite = env->NewObject(boxing.ite, boxing.ite_init, target_exception);
+        // Ensure NewObject didn't fail due to OOM before throwing
+        if (ite) env->Throw(static_cast<jthrowable>(ite));
+        return nullptr;
+    }
+
+    // --- Box Return Value ---
+    return Box(env, boxing, plan.shorty[0], ret_val);
+}
+
+/**
+ * @brief Replaces a pending InvocationTargetException with its cause, which is what the callee
+ * threw.
+ */
+void UnwrapInvocationTargetException(JNIEnv *env) {
+    const auto &boxing = Boxing::Get();
+    jthrowable pending = env->ExceptionOccurred();
+    if (!pending) return;
+    if (env->IsInstanceOf(pending, boxing.ite)) {
+        env->ExceptionClear();
+        auto cause = static_cast<jthrowable>(env->CallObjectMethod(pending, boxing.ite_get_cause));
+        env->Throw(cause ? cause : pending);
+        if (cause) env->DeleteLocalRef(cause);
+    }
+    env->DeleteLocalRef(pending);
+}
+
+/**
+ * @brief Runs the original of [target] on [thiz] with [args] from index [first] on, as
+ * invokeOriginalMethod documents. [cell] is the method's registry cell, or nullptr if it was never
+ * hooked. With [wrap] false, an exception of the original is left pending as it was thrown.
+ */
+jobject InvokeOriginal(JNIEnv *env, jmethodID target, HookCell *cell, jobject hookMethod,
+                       jobject thiz, jobjectArray args, jsize first = 0, bool wrap = true) {
+    jobject backup = nullptr;
+    jmethodID backup_method = nullptr;
+    bool hooked = false;
+    if (cell) {
+        // The backup is pinned by a local reference rather than the guard: the original may run
+        // for as long as it likes, and must not hold up reclamation meanwhile.
+        EpochDomain::Guard guard;
+        // If a hook item exists, invoke its backup. Otherwise, invoke the method directly
+        // (though this case should be rare if called from a hook callback).
+        if (auto *hook_item = cell->item.load(std::memory_order_acquire)) {
+            hooked = true;
+            if (auto item_backup = hook_item->GetBackup()) {
+                backup = env->NewLocalRef(item_backup);
+                backup_method = hook_item->backup_method;
+            }
+        }
+    }
+    if (hooked && !backup) {
+        // Hooking might have failed or is not complete.
+        return nullptr;
+    }
+
+    const InvokePlan *plan = cell ? cell->plan.load(std::memory_order_acquire) : nullptr;
+    if (!plan) {
+        plan = GetInvokePlan(env, target, hookMethod);
+        if (plan && cell) cell->plan.store(plan, std::memory_order_release);
+    }
+
+    jobject result;
+    if (plan) {
+        // A cell without an item is a hook reclaimed while its call was running, and [target] is
+        // the original again: calling it virtually would reach an override in a subclass of [thiz],
+        // which the backup never would.
+        auto dispatch = plan->is_static ? Dispatch::kStatic
+                        : cell || plan->is_constructor ? Dispatch::kNonvirtual
+                                                       : Dispatch::kVirtual;
+        result = Invoke(env, *plan, hooked ? backup_method : target, dispatch,
+                        plan->declaring_class, thiz, args, first, wrap);
+    } else {
+        env->ExceptionClear();
+        // Method.invoke has no notion of an offset, so this rare path pays for the copy.
+        if (first > 0) {
+            const jsize count = env->GetArrayLength(args) - first;
+            auto unpacked = env->NewObjectArray(count, object_class, nullptr);
+            if (!unpacked) return nullptr;
+            for (jsize i = 0; i < count; ++i) {
+                auto element = env->GetObjectArrayElement(args, first + i);
+                env->SetObjectArrayElement(unpacked, i, element);
+                env->DeleteLocalRef(element);
+            }
+            args = unpacked;
+        }
+        result = env->CallObjectMethod(hooked ? backup : hookMethod, invoke, thiz, args);
+        if (!wrap) UnwrapInvocationTargetException(env);
+    }
+    if (backup) env->DeleteLocalRef(backup);
+    return result;
+}
 
 }  // namespace
 
@@ -102,85 +2892,80 @@ namespace vector::native::jni {
  * @param hooker The Java class that acts as the hook trampoline.
  * @param priority The priority of this callback.
  * @param callback The Java callback object.
+ * @param owner The class loader of the module registering it, which hookStats attributes it to.
  * @return JNI_TRUE on success, JNI_FALSE on failure.
  */
 VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, hookMethod, jboolean useModernApi,
-                         jobject hookMethod, jclass hooker, jint priority, jobject callback) {
-    bool newHook = false;
+                         jobject hookMethod, jclass hooker, jint priority, jobject callback,
+                         jobject owner) {
+    ReclaimIdleHooks(env);
 
-#ifndef NDEBUG
-    // Simple RAII struct for performance timing in debug builds.
-    struct finally {
-        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
-        bool &newHook;
-        ~finally() {
-            auto finish = std::chrono::steady_clock::now();
-            if (newHook) {
-                LOGV("New hook took {}us",
-                     std::chrono::duration_cast<std::chrono::microseconds>(finish - start).count());
-            }
-        }
-    } finally{.newHook = newHook};
-#endif
+    auto *hooker_info = GetHookerInfo(env, hooker);
+    if (!hooker_info) return JNI_FALSE;
 
-    auto target = env->FromReflectedMethod(hookMethod);
-    HookItem *hook_item = nullptr;
-
-    // Atomically find or create an entry for the target method.
-    // This is a highly concurrent operation.
-    hooked_methods.lazy_emplace_l(
-        target,
-        // Lambda for existing element: just get the pointer.
-        [&hook_item](auto &it) { hook_item = it.second.get(); },
-        // Lambda for new element: create the HookItem and mark it as a new hook.
-        [&hook_item, &target, &newHook](const auto &ctor) {
-            auto ptr = std::make_unique<HookItem>();
-            hook_item = ptr.get();
-            ctor(target, std::move(ptr));
-            newHook = true;
-        });
+    auto owner_id = GetOwnerId(env, owner);
+    if (DeferHook(env, hookMethod, *hooker_info,
+                  {static_cast<bool>(useModernApi), callback, priority, owner_id})) {
+        return JNI_TRUE;
+    }
+    EpochDomain::Guard guard;
+    return HookOne(env, useModernApi, hookMethod, *hooker_info, priority, callback, owner_id);
+}
 
-    // If this is the first time this method is being hooked,
-    // we need to perform the actual native hook using lsplant.
-    if (newHook) {
-        auto init = env->GetMethodID(hooker, "<init>", "(Ljava/lang/reflect/Executable;)V");
-        auto callback_method = env->ToReflectedMethod(
-            hooker, env->GetMethodID(hooker, "callback", "([Ljava/lang/Object;)Ljava/lang/Object;"),
-            false);
-        auto hooker_object = env->NewObject(hooker, init, hookMethod);
-        // Use lsplant to replace the target method with our trampoline.
-        // The returned jobject is a handle to the original method.
-        hook_item->SetBackup(lsplant::Hook(env, hookMethod, hooker_object, callback_method));
-        env->DeleteLocalRef(hooker_object);
-    }
-
-    // Wait for the backup to become available (it might be set by another thread).
-    jobject backup = hook_item->GetBackup();
-    if (!backup) return JNI_FALSE;
+/**
+ * @brief Registers one callback on a whole set of methods in a single JNI transition.
+ *
+ * This is what hookAllMethods and hookAllConstructors come down to. The hooker class is resolved
+ * once and idle hooks are swept once for the whole batch, rather than once per method. lsplant
+ * still installs each trampoline on its own, since it has no batched form.
+ *
+ * A null element, or one that cannot be hooked, fails on its own without affecting the rest.
+ *
+ * @return One entry per element of [hookMethods], JNI_TRUE where the callback was registered.
+ */
+VECTOR_DEF_NATIVE_METHOD(jbooleanArray, HookBridge, hookMethods, jboolean useModernApi,
+                         jobjectArray hookMethods, jclass hooker, jint priority,
+                         jobject callback, jobject owner) {
+    const jsize count = hookMethods ? env->GetArrayLength(hookMethods) : 0;
+    auto results = env->NewBooleanArray(count);
+    if (!results) return nullptr;
+    if (count == 0) return results;
 
-    // Use an RAII monitor to lock the backup object,
-    // ensuring thread-safe modification of the callback lists.
-    lsplant::JNIMonitor monitor(env, backup);
+    ReclaimIdleHooks(env);
 
-    // Store a global reference to the callback object itself.
-    if (useModernApi) {
-        hook_item->modern_callbacks.emplace(priority, env->NewGlobalRef(callback));
-    } else {
-        hook_item->legacy_callbacks.emplace(priority, env->NewGlobalRef(callback));
+    std::vector<jboolean> hooked(count, JNI_FALSE);
+    if (auto *hooker_info = GetHookerInfo(env, hooker)) {
+        auto owner_id = GetOwnerId(env, owner);
+        EpochDomain::Guard guard;
+        for (jsize i = 0; i < count; ++i) {
+            auto method = env->GetObjectArrayElement(hookMethods, i);
+            if (!method) continue;
+            hooked[i] =
+                DeferHook(env, method, *hooker_info,
+                          {static_cast<bool>(useModernApi), callback, priority, owner_id}) ||
+                HookOne(env, useModernApi, method, *hooker_info, priority, callback, owner_id);
+            env->DeleteLocalRef(method);
+        }
     }
-    return JNI_TRUE;
+    env->SetBooleanArrayRegion(results, 0, count, hooked.data());
+    return results;
 }
 
 /**
  * @brief JNI method to remove a previously installed hook callback.
+ *
+ * Removing the last callback leaves the hook idle: hooked calls go straight to the original, and
+ * the trampoline itself is removed once the hook has stayed idle for the configured timeout.
  */
 VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, unhookMethod, jboolean useModernApi,
                          jobject hookMethod, jobject callback) {
+    ReclaimIdleHooks(env);
+
     auto target = env->FromReflectedMethod(hookMethod);
-    HookItem *hook_item = nullptr;
+    InstallDeferredHooks(env, target);
+    EpochDomain::Guard guard;
     // Find the HookItem for the target method.
-    hooked_methods.if_contains(target,
-                               [&hook_item](const auto &it) { hook_item = it.second.get(); });
+    HookItem *hook_item = FindHookItem(target);
     if (!hook_item) return JNI_FALSE;
 
     jobject backup = hook_item->GetBackup();
@@ -188,34 +2973,44 @@ VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, unhookMethod, jboolean useModernA
 
     // Lock to safely modify the callback list.
     lsplant::JNIMonitor monitor(env, backup);
+    // Only an idle hook is ever removed, so the callback is not on it.
+    if (hook_item->retired) return JNI_FALSE;
 
-    // Select the correct multimap
+    // Select the correct list
     auto &callbacks = useModernApi ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
 
     // Find the callback by comparing the jobject directly.
-    for (auto i = callbacks.begin(); i != callbacks.end(); ++i) {
-        if (env->IsSameObject(i->second, callback)) {
-            env->DeleteGlobalRef(i->second);  // Clean up the global reference.
-            callbacks.erase(i);
-            return JNI_TRUE;
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+        if (!env->IsSameObject(callbacks[i].object, callback)) continue;
+
+        auto removed = callbacks[i];
+        callbacks.Erase(i);
+        if (!hook_item->PublishSnapshot(env)) {
+            // The published snapshot still runs it, so it has to stay registered too.
+            callbacks.InsertAt(i, removed);
+            return JNI_FALSE;
         }
+        // A snapshot a call in flight still holds references the callback through its own array.
+        env->DeleteGlobalRef(removed.object);
+        RetireOptions(env, removed.options);
+        return JNI_TRUE;
     }
 
     return JNI_FALSE;
 }
 
 /**
- * @brief Swaps one registered callback for another in a single locked step.
+ * @brief Swaps one registered callback for another in a single published step.
  *
  * API 102's HookHandle#replaceHook and HookBuilder#setId both promise that a replacement is atomic:
  * no window in which both the old and the new hooker are on the chain, and none in which neither
  * is. Doing it as unhook-then-hook from Java can promise neither.
  *
- * The lock taken here is the one callbackSnapshot takes, so a snapshot sees exactly one of the two.
- * A snapshot taken before the swap keeps working afterwards because it copied the reference into a
- * Java array, which is a strong reference of its own - that is what lets a call already in flight
- * keep running the old hooker, as the interface requires, without the chain having to freeze a
- * hooker list of its own on every single hooked call.
+ * The change reaches hooked calls as one pointer swap of the snapshot, so a call sees exactly one of
+ * the two. A call that loaded the previous snapshot keeps working afterwards because that snapshot
+ * is an array of its own, a strong reference to the old hooker - that is what lets a call already
+ * in flight keep running the old hooker, as the interface requires, without the chain having to
+ * freeze a hooker list of its own on every single hooked call.
  *
  * The entry keeps its place among equal priorities when the priority does not change, which is what
  * replaceHook means by "keeps the priority": re-inserting would move it behind its peers.
@@ -226,38 +3021,123 @@ VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, replaceCallback, jboolean useMode
                          jobject hookMethod, jobject oldCallback, jobject newCallback,
                          jint newPriority) {
     auto target = env->FromReflectedMethod(hookMethod);
-    HookItem *hook_item = nullptr;
-    hooked_methods.if_contains(target,
-                               [&hook_item](const auto &it) { hook_item = it.second.get(); });
+    InstallDeferredHooks(env, target);
+    EpochDomain::Guard guard;
+    HookItem *hook_item = FindHookItem(target);
     if (!hook_item) return JNI_FALSE;
 
     jobject backup = hook_item->GetBackup();
     if (!backup) return JNI_FALSE;
 
     lsplant::JNIMonitor monitor(env, backup);
+    if (hook_item->retired) return JNI_FALSE;
 
     auto &callbacks = useModernApi ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
 
-    for (auto i = callbacks.begin(); i != callbacks.end(); ++i) {
-        if (!env->IsSameObject(i->second, oldCallback)) continue;
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+        if (!env->IsSameObject(callbacks[i].object, oldCallback)) continue;
 
         auto replacement = env->NewGlobalRef(newCallback);
         // Nothing has been changed yet, so the caller's hook is still whatever it was.
         if (!replacement) return JNI_FALSE;
 
-        env->DeleteGlobalRef(i->second);
-        if (i->first == newPriority) {
-            i->second = replacement;
+        auto replaced = callbacks[i];
+        auto index = i;
+        // The replacement comes from the same module, so it keeps the attribution.
+        if (replaced.priority == newPriority) {
+            callbacks[i].object = replacement;
         } else {
-            callbacks.erase(i);
-            callbacks.emplace(newPriority, replacement);
+            auto moved = replaced;
+            moved.object = replacement;
+            moved.priority = newPriority;
+            callbacks.Erase(i);
+            index = callbacks.Insert(moved);
+        }
+
+        if (!hook_item->PublishSnapshot(env)) {
+            // Put the old entry back where it was, so the lists keep matching what is published.
+            callbacks.Erase(index);
+            callbacks.InsertAt(i, replaced);
+            env->DeleteGlobalRef(replacement);
+            return JNI_FALSE;
         }
+        env->DeleteGlobalRef(replaced.object);
         return JNI_TRUE;
     }
 
     return JNI_FALSE;
 }
 
+/**
+ * @brief Removes or replaces a whole set of callbacks in one call, as retiring a module generation
+ * on hot reload does.
+ *
+ * Element i of oldCallbacks is looked for on methods[i]. It is replaced by newCallbacks[i] at
+ * newPriorities[i], or removed when newCallbacks is null or its element is. The edits are grouped
+ * by method, so each affected hook is looked up, locked and published once, however many of its
+ * callbacks change.
+ *
+ * @return One entry per element of methods, JNI_TRUE where the callback was found and changed.
+ */
+VECTOR_DEF_NATIVE_METHOD(jbooleanArray, HookBridge, updateCallbacks, jboolean useModernApi,
+                         jobjectArray methods, jobjectArray oldCallbacks, jobjectArray newCallbacks,
+                         jintArray newPriorities) {
+    const jsize count = methods ? env->GetArrayLength(methods) : 0;
+    auto results = env->NewBooleanArray(count);
+    if (!results) return nullptr;
+    if (count == 0) return results;
+
+    std::vector<jint> priorities(count, 0);
+    if (newPriorities) env->GetIntArrayRegion(newPriorities, 0, count, priorities.data());
+
+    // Callbacks are held as local references until the edits are done.
+    if (env->EnsureLocalCapacity(count * 2) != JNI_OK) return nullptr;
+    std::vector<CallbackEdit> edits;
+    edits.reserve(count);
+    for (jsize i = 0; i < count; ++i) {
+        auto method = env->GetObjectArrayElement(methods, i);
+        if (!method) continue;
+        auto target = env->FromReflectedMethod(method);
+        env->DeleteLocalRef(method);
+        if (!target) continue;
+        edits.push_back(CallbackEdit{
+            .index = i,
+            .target = target,
+            .old_callback = env->GetObjectArrayElement(oldCallbacks, i),
+            .new_callback = newCallbacks ? env->GetObjectArrayElement(newCallbacks, i) : nullptr,
+            .new_priority = priorities[i],
+        });
+    }
+    // Stable, so several edits to one hook apply in the order they were given.
+    std::stable_sort(edits.begin(), edits.end(),
+                     [](const auto &a, const auto &b) { return a.target < b.target; });
+
+    {
+        EpochDomain::Guard guard;
+        for (auto first = edits.begin(); first != edits.end();) {
+            auto last = std::find_if(first, edits.end(), [first](const auto &edit) {
+                return edit.target != first->target;
+            });
+            // A request still deferred is edited as what it will be: an installed hook.
+            InstallDeferredHooks(env, first->target);
+            EditCallbacks(env, useModernApi, std::span(first, last));
+            first = last;
+        }
+    }
+
+    std::vector<jboolean> updated(count, JNI_FALSE);
+    for (const auto &edit : edits) {
+        updated[edit.index] = edit.applied;
+        if (edit.old_callback) env->DeleteLocalRef(edit.old_callback);
+        if (edit.new_callback) env->DeleteLocalRef(edit.new_callback);
+    }
+    env->SetBooleanArrayRegion(results, 0, count, updated.data());
+
+    // What the batch left without callbacks gets the usual grace period; older idle hooks do not.
+    ReclaimIdleHooks(env);
+    return results;
+}
+
 /**
  * @brief JNI method to request de-optimization of a method.
  * This can be necessary for some types of hooks to work correctly on JIT-compiled methods.
@@ -266,284 +3146,292 @@ VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, deoptimizeMethod, jobject hookMet
     return lsplant::Deoptimize(env, hookMethod);
 }
 
+/**
+ * @brief deoptimizeMethod for every element of [methods], in one call.
+ *
+ * @return One entry per element: how long deoptimizing it took in nanoseconds, or -1 where it was
+ * null or could not be deoptimized.
+ */
+VECTOR_DEF_NATIVE_METHOD(jlongArray, HookBridge, deoptimizeMethods, jobjectArray methods) {
+    const jsize count = methods ? env->GetArrayLength(methods) : 0;
+    auto results = env->NewLongArray(count);
+    if (!results || count == 0) return results;
+
+    std::vector<jlong> elapsed(count, -1);
+    for (jsize i = 0; i < count; ++i) {
+        auto method = env->GetObjectArrayElement(methods, i);
+        if (!method) continue;
+        auto start = std::chrono::steady_clock::now();
+        bool deoptimized = lsplant::Deoptimize(env, method);
+        auto finish = std::chrono::steady_clock::now();
+        if (deoptimized) {
+            elapsed[i] =
+                std::chrono::duration_cast<std::chrono::nanoseconds>(finish - start).count();
+        }
+        env->DeleteLocalRef(method);
+    }
+    env->SetLongArrayRegion(results, 0, count, elapsed.data());
+    return results;
+}
+
 /**
  * @brief JNI method to invoke the original, un-hooked method.
+ *
+ * The call goes through the method's cached InvokePlan instead of Method.invoke, so the parameter
+ * types and access checks are not worked out again on every call. A hooked method is called
+ * non-virtually on its backup; a method that is not hooked is dispatched the way reflection would.
  */
 VECTOR_DEF_NATIVE_METHOD(jobject, HookBridge, invokeOriginalMethod, jobject hookMethod,
                          jobject thiz, jobjectArray args) {
     auto target = env->FromReflectedMethod(hookMethod);
-    HookItem *hook_item = nullptr;
-    hooked_methods.if_contains(target,
-                               [&hook_item](const auto &it) { hook_item = it.second.get(); });
-
-    // If a hook item exists, invoke its backup. Otherwise, invoke the method directly
-    // (though this case should be rare if called from a hook callback).
-    jobject method_to_invoke = hook_item ? hook_item->GetBackup() : hookMethod;
-    if (!method_to_invoke) {
-        // Hooking might have failed or is not complete.
+    HookCell *cell;
+    {
+        EpochDomain::Guard guard;
+        cell = hooked_methods.FindCell(target);
+    }
+    return InvokeOriginal(env, target, cell, hookMethod, thiz, args);
+}
+
+/**
+ * @brief invokeOriginalMethod for a hooker, which names its method by the handle it was
+ * constructed with rather than having it looked up. [hookMethod] is only read when the method's
+ * invocation plan has not been built yet.
+ *
+ * The arguments are those of [args] from [argsOffset] on. A hooker passes 1 with the array the
+ * trampoline handed it, whose first element is the receiver, so that a call no callback changed the
+ * arguments of reaches the original without the array ever being copied.
+ *
+ * Unlike invokeOriginalMethod, an exception of the original is thrown as it is. The hooker rethrows
+ * it to the caller anyway, and an InvocationTargetException built only to be unwrapped again costs
+ * a stack trace on every throwing call.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobject, HookBridge, handleInvokeOriginal, jlong handle,
+                         jobject hookMethod, jobject thiz, jobjectArray args, jint argsOffset) {
+    auto *cell = HookCell::FromHandle(handle);
+    if (argsOffset < 0 || (argsOffset > 0 && (!args || env->GetArrayLength(args) < argsOffset))) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
+                      "argsOffset out of range");
         return nullptr;
     }
-    return env->CallObjectMethod(method_to_invoke, invoke, thiz, args);
+    return InvokeOriginal(env, cell->target, cell, hookMethod, thiz, args, argsOffset, false);
 }
 
 /**
- * @brief JNI wrapper around AllocObject.
+ * @brief Sets how long a hook may stay without callbacks before it is removed.
+ * @param timeoutMillis Negative keeps idle hooks installed for good.
  */
-VECTOR_DEF_NATIVE_METHOD(jobject, HookBridge, allocateObject, jclass cls) {
-    return env->AllocObject(cls);
+VECTOR_DEF_NATIVE_METHOD(void, HookBridge, setIdleHookTimeout, jlong timeoutMillis) {
+    idle_hook_timeout.store(timeoutMillis < 0 ? -1
+                                              : std::chrono::nanoseconds(
+                                                    std::chrono::milliseconds(timeoutMillis))
+                                                    .count(),
+                            std::memory_order_relaxed);
 }
 
 /**
- * Core JNI backend for non-virtual method invocation and special object initialization.
- *
- * Implementation details:
- * 1. Dispatches using JNI CallNonvirtual<Type>MethodA.
- * 2. Employs stack allocation (alloca) for JNI argument mapping.
- * 3. Safely mirrors standard Java reflection (NPEs on null primitives/receivers).
- * 4. Prevents JNI Type Confusion and memory leaks by caching primitive wrappers globally,
- *    while leveraging java.lang.Number for fast implicit widening/narrowing.
- * 5. Accurately catches and wraps target method exceptions into InvocationTargetException.
- */
-VECTOR_DEF_NATIVE_METHOD(jobject, HookBridge, invokeSpecialMethod, jobject method,
-                         jcharArray shorty, jclass cls, jobject thiz, jobjectArray args) {
-    // --- JNI Global Reference Caching ---
-    // Cached once per process lifecycle to maintain extreme performance and prevent JNI aborts.
-    static jclass cls_Number = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Number"));
-    static jclass cls_Boolean = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Boolean"));
-    static jclass cls_Character = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Character"));
-
-    // Globally cache primitive wrapper classes for safe return value boxing
-    static jclass cls_Integer = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Integer"));
-    static jclass cls_Double = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Double"));
-    static jclass cls_Long = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Long"));
-    static jclass cls_Float = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Float"));
-    static jclass cls_Short = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Short"));
-    static jclass cls_Byte = (jclass)env->NewGlobalRef(env->FindClass("java/lang/Byte"));
-
-    static jclass cls_ITE =
-        (jclass)env->NewGlobalRef(env->FindClass("java/lang/reflect/InvocationTargetException"));
-
-    static auto *const ctor_ite = env->GetMethodID(cls_ITE, "<init>", "(Ljava/lang/Throwable;)V");
-
-    static auto *const get_int = env->GetMethodID(cls_Number, "intValue", "()I");
-    static auto *const get_double = env->GetMethodID(cls_Number, "doubleValue", "()D");
-    static auto *const get_long = env->GetMethodID(cls_Number, "longValue", "()J");
-    static auto *const get_float = env->GetMethodID(cls_Number, "floatValue", "()F");
-    static auto *const get_short = env->GetMethodID(cls_Number, "shortValue", "()S");
-    static auto *const get_byte = env->GetMethodID(cls_Number, "byteValue", "()B");
-
-    static auto *const get_char = env->GetMethodID(cls_Character, "charValue", "()C");
-    static auto *const get_boolean = env->GetMethodID(cls_Boolean, "booleanValue", "()Z");
-
-    static auto *const set_int =
-        env->GetStaticMethodID(cls_Integer, "valueOf", "(I)Ljava/lang/Integer;");
-    static auto *const set_double =
-        env->GetStaticMethodID(cls_Double, "valueOf", "(D)Ljava/lang/Double;");
-    static auto *const set_long =
-        env->GetStaticMethodID(cls_Long, "valueOf", "(J)Ljava/lang/Long;");
-    static auto *const set_float =
-        env->GetStaticMethodID(cls_Float, "valueOf", "(F)Ljava/lang/Float;");
-    static auto *const set_short =
-        env->GetStaticMethodID(cls_Short, "valueOf", "(S)Ljava/lang/Short;");
-    static auto *const set_byte =
-        env->GetStaticMethodID(cls_Byte, "valueOf", "(B)Ljava/lang/Byte;");
-    static auto *const set_char =
-        env->GetStaticMethodID(cls_Character, "valueOf", "(C)Ljava/lang/Character;");
-    static auto *const set_boolean =
-        env->GetStaticMethodID(cls_Boolean, "valueOf", "(Z)Ljava/lang/Boolean;");
+ * @brief Removes every hook that has outlived the idle timeout now, rather than at the next
+ * hookMethod or unhookMethod.
+ * @return The number of hooks removed.
+ */
+VECTOR_DEF_NATIVE_METHOD(jint, HookBridge, reclaimIdleHooks) { return ReclaimIdleHooks(env); }
 
+/**
+ * @brief Counts one call of a hooked method towards hookStats.
+ * @param totalNanos How long the hooked call took, callbacks and original together.
+ * @param originalNanos How much of that the original took.
+ */
+VECTOR_DEF_NATIVE_METHOD(void, HookBridge, recordInvocation, jobject method, jlong totalNanos,
+                         jlong originalNanos) {
     auto target = env->FromReflectedMethod(method);
-    auto param_len = env->GetArrayLength(shorty) - 1;
-
-    // --- Argument & Receiver Validation ---
-    auto args_len = args != nullptr ? env->GetArrayLength(args) : 0;
-    if (args_len != param_len) {
-        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
-                      "args.length does not match parameter count");
-        return nullptr;
+    EpochDomain::Guard guard;
+    if (auto *hook_item = FindHookItem(target)) {
+        hook_item->RecordInvocation(totalNanos, originalNanos);
     }
+}
 
-    if (thiz == nullptr) {
-        env->ThrowNew(env->FindClass("java/lang/NullPointerException"), "null receiver");
-        return nullptr;
+/**
+ * @brief recordInvocation for a hooker, by the handle it was constructed with, which also appends
+ * the call to the hook trace while one is running, and memoizes its result when the hook does.
+ * @param startNanos System.nanoTime when the hooked call was entered.
+ * @param beforeNanos How long it took to reach the original, or totalNanos when it never did.
+ * @param callbacks How many callbacks the call ran.
+ * @param result What the call returned, when [returned]; false means it threw.
+ */
+VECTOR_DEF_NATIVE_METHOD(void, HookBridge, handleRecordInvocation, jlong handle,
+                         jlong startNanos, jlong totalNanos, jlong originalNanos,
+                         jlong beforeNanos, jint callbacks, jobject result, jboolean returned) {
+    EpochDomain::Guard guard;
+    auto *cell = HookCell::FromHandle(handle);
+    // The call is leaving its Java dispatch; it was pushed if its method tracks reentry.
+    if (!dispatching.empty() && dispatching.back() == cell) dispatching.pop_back();
+    auto *hook_item = cell->item.load(std::memory_order_acquire);
+    HookItem::RecordMemo(env, cell, hook_item, result, returned);
+    if (hook_item) {
+        hook_item->RecordInvocation(totalNanos, originalNanos);
+        auto &trace = HookTrace::Instance();
+        if (trace.Enabled()) {
+            trace.Record(cell, startNanos, totalNanos, originalNanos, beforeNanos, callbacks);
+        }
     }
+}
 
-    // Allocate jvalue array on the stack
-    jvalue *a = param_len > 0 ? static_cast<jvalue *>(alloca(param_len * sizeof(jvalue))) : nullptr;
+/**
+ * @brief Opens a window in which hookMethod, called on this thread, queues requests on classes
+ * that are not initialized yet rather than installing them one by one. Windows nest, and belong to
+ * the thread that opened them.
+ */
+VECTOR_DEF_NATIVE_METHOD(void, HookBridge, beginDeferredHooks) { ++defer_depth; }
 
-    auto *const shorty_char = env->GetCharArrayElements(shorty, nullptr);
-    if (shorty_char == nullptr) {
-        return nullptr;  // JVM already threw OutOfMemoryError
+/**
+ * @brief Closes a window opened by beginDeferredHooks on this thread. Closing the outermost one
+ * installs what this thread queued in one batch.
+ * @return The callbacks of the requests this thread queued that could not be installed, whether by
+ *         the batch or earlier, by an edit that had to install them first; null when there are
+ *         none. hookMethod reported each of them as registered.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobjectArray, HookBridge, endDeferredHooks) {
+    if (defer_depth == 0 || --defer_depth > 0) return nullptr;
+    const pid_t thread = gettid();
+    if (auto installed = InstallDeferredHooks(env, nullptr, thread); installed > 0) {
+        LOGD("Installed {} deferred hook(s)", installed);
     }
 
-    // RAII/Helper for clean JNI array exits
-    auto abort_and_return = [&]() {
-        env->ReleaseCharArrayElements(shorty, shorty_char, JNI_ABORT);
-        return nullptr;
-    };
+    std::vector<jobject> dropped;
+    {
+        std::lock_guard lk(deferred_lock);
+        auto split = std::stable_partition(
+            dropped_hooks.begin(), dropped_hooks.end(),
+            [thread](const auto &entry) { return entry.first != thread; });
+        for (auto it = split; it != dropped_hooks.end(); ++it) dropped.push_back(it->second);
+        dropped_hooks.erase(split, dropped_hooks.end());
+    }
+    if (dropped.empty()) return nullptr;
 
-    // --- Safe Unboxing ---
-    for (jint i = 0; i != param_len; ++i) {
-        jobject element = env->GetObjectArrayElement(args, i);
-        if (env->ExceptionCheck()) return abort_and_return();
+    auto result = env->NewObjectArray(static_cast<jsize>(dropped.size()), object_class, nullptr);
+    for (size_t i = 0; result && i < dropped.size(); ++i) {
+        env->SetObjectArrayElement(result, static_cast<jsize>(i), dropped[i]);
+    }
+    for (auto callback : dropped) env->DeleteGlobalRef(callback);
+    return result;
+}
+
+/**
+ * @brief Starts recording every hooked call into the shared-memory hook trace, which the daemon
+ * reads from outside the process.
+ * @param capacity Records the ring holds, rounded up to a power of two. Only the first start of a
+ * process sizes the buffer; later ones resume the same one.
+ */
+VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, startHookTrace, jint capacity) {
+    return HookTrace::Instance().Start(env, static_cast<uint32_t>(std::max(capacity, 0)));
+}
 
-        char type = shorty_char[i + 1];
+/**
+ * @brief Stops recording into the hook trace. What it holds stays readable.
+ */
+VECTOR_DEF_NATIVE_METHOD(void, HookBridge, stopHookTrace) { HookTrace::Instance().Stop(); }
 
-        if (element == nullptr) {
-            if (type != 'L' && type != '[') {
-                env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
-                              "null primitive argument");
-                return abort_and_return();
-            }
-            a[i].l = nullptr;
-        } else {
-            if (type == 'Z') {
-                if (!env->IsInstanceOf(element, cls_Boolean)) {
-                    env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
-                                  "Expected Boolean");
-                    return abort_and_return();
-                }
-                a[i].z = env->CallBooleanMethod(element, get_boolean);
-            } else if (type == 'C') {
-                if (!env->IsInstanceOf(element, cls_Character)) {
-                    env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
-                                  "Expected Character");
-                    return abort_and_return();
-                }
-                a[i].c = env->CallCharMethod(element, get_char);
-            } else if (type != 'L' && type != '[') {
-                bool is_number = env->IsInstanceOf(element, cls_Number) == JNI_TRUE;
-                bool is_character =
-                    !is_number && (env->IsInstanceOf(element, cls_Character) == JNI_TRUE);
-
-                if (!is_number && !is_character) {
-                    env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
-                                  "Expected Number or Character");
-                    return abort_and_return();
-                }
+/**
+ * @brief Returns the counters of every hook that has been called so far, as the Object[]
+ * {long[] stats, Object[] methods, Object[] owners}.
+ *
+ * stats starts with the number of histogram buckets and the bound of the first one as a power of
+ * two, in nanoseconds. One record per element of methods follows: invocations, nanoseconds spent in
+ * callbacks, the longest any single call spent in them, nanoseconds spent in the original, the
+ * number of owners with a callback on the hook followed by their indexes into owners, and then the
+ * callback latency histogram. owners holds the class loaders given to hookMethod, null at index 0.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobjectArray, HookBridge, hookStats) {
+    // Items are held by the guard throughout, so their targets can go into the array as they are.
+    EpochDomain::Guard guard;
+    std::vector<HookItem *> items;
+    hooked_methods.ForEach([&items](jmethodID, HookItem *hook_item) {
+        if (hook_item->Stats()) items.push_back(hook_item);
+    });
 
-                // If a Character is passed to a numeric parameter, extract its value for widening
-                jchar c_val = 0;
-                if (is_character) {
-                    c_val = env->CallCharMethod(element, get_char);
-                    if (env->ExceptionCheck()) return abort_and_return();
-                }
+    std::vector<jlong> stats{HookStats::kBuckets, HookStats::kFirstBucketShift};
+    std::vector<jobject> methods;
+    for (auto *hook_item : items) {
+        jobject backup = hook_item->GetBackup();
+        if (!backup) continue;
 
-                switch (type) {
-                case 'I':
-                    a[i].i = env->CallIntMethod(element, get_int);
-                    break;
-                case 'D':
-                    a[i].d = env->CallDoubleMethod(element, get_double);
-                    break;
-                case 'J':
-                    a[i].j = env->CallLongMethod(element, get_long);
-                    break;
-                case 'F':
-                    a[i].f = env->CallFloatMethod(element, get_float);
-                    break;
-                case 'S':
-                    a[i].s = env->CallShortMethod(element, get_short);
-                    break;
-                case 'B':
-                    a[i].b = env->CallByteMethod(element, get_byte);
-                    break;
+        std::vector<jint> hook_owners;
+        {
+            lsplant::JNIMonitor monitor(env, backup);
+            if (hook_item->retired) continue;
+            for (const auto *callbacks :
+                 {&hook_item->modern_callbacks, &hook_item->legacy_callbacks}) {
+                for (const auto &callback : *callbacks) {
+                    if (std::find(hook_owners.begin(), hook_owners.end(), callback.owner) ==
+                        hook_owners.end()) {
+                        hook_owners.push_back(callback.owner);
+                    }
                 }
-            } else {
-                a[i].l = element;
-                element =
-                    nullptr;  // Transferred ownership to jvalue array; will be freed on return
             }
         }
 
-        if (element) env->DeleteLocalRef(element);
-        if (env->ExceptionCheck()) return abort_and_return();
+        auto totals = hook_item->Stats()->Sum();
+        stats.insert(stats.end(), {static_cast<jlong>(totals.invocations),
+                                   static_cast<jlong>(totals.callback_nanos),
+                                   static_cast<jlong>(totals.max_callback_nanos),
+                                   static_cast<jlong>(totals.original_nanos),
+                                   static_cast<jlong>(hook_owners.size())});
+        stats.insert(stats.end(), hook_owners.begin(), hook_owners.end());
+        stats.insert(stats.end(), std::begin(totals.histogram), std::end(totals.histogram));
+        methods.push_back(hook_item->target);
     }
 
-    // --- Non-virtual Invocation ---
-    jvalue ret_val;
-    switch (shorty_char[0]) {
-    case 'I':
-        ret_val.i = env->CallNonvirtualIntMethodA(thiz, cls, target, a);
-        break;
-    case 'D':
-        ret_val.d = env->CallNonvirtualDoubleMethodA(thiz, cls, target, a);
-        break;
-    case 'J':
-        ret_val.j = env->CallNonvirtualLongMethodA(thiz, cls, target, a);
-        break;
-    case 'F':
-        ret_val.f = env->CallNonvirtualFloatMethodA(thiz, cls, target, a);
-        break;
-    case 'S':
-        ret_val.s = env->CallNonvirtualShortMethodA(thiz, cls, target, a);
-        break;
-    case 'B':
-        ret_val.b = env->CallNonvirtualByteMethodA(thiz, cls, target, a);
-        break;
-    case 'C':
-        ret_val.c = env->CallNonvirtualCharMethodA(thiz, cls, target, a);
-        break;
-    case 'Z':
-        ret_val.z = env->CallNonvirtualBooleanMethodA(thiz, cls, target, a);
-        break;
-    case 'L':
-        ret_val.l = env->CallNonvirtualObjectMethodA(thiz, cls, target, a);
-        break;
-    default:
-        env->CallNonvirtualVoidMethodA(thiz, cls, target, a);
-        break;
+    auto stats_array = env->NewLongArray(static_cast<jsize>(stats.size()));
+    if (!stats_array) return nullptr;
+    env->SetLongArrayRegion(stats_array, 0, static_cast<jsize>(stats.size()), stats.data());
+
+    auto methods_array =
+        env->NewObjectArray(static_cast<jsize>(methods.size()), object_class, nullptr);
+    if (!methods_array) return nullptr;
+    for (size_t i = 0; i < methods.size(); ++i) {
+        env->SetObjectArrayElement(methods_array, static_cast<jsize>(i), methods[i]);
     }
 
-    // --- Exception Wrapping ---
-    jthrowable target_exception = env->ExceptionOccurred();
-    if (target_exception) {
-        env->ExceptionClear();
-        jobject ite = env->NewObject(cls_ITE, ctor_ite, target_exception);
-        // Ensure NewObject didn't fail due to OOM before throwing
-        if (ite) {
-            env->Throw(static_cast<jthrowable>(ite));
+    jobjectArray owners_array;
+    {
+        std::lock_guard lk(owners_lock);
+        owners_array =
+            env->NewObjectArray(static_cast<jsize>(owners.size()), object_class, nullptr);
+        if (!owners_array) return nullptr;
+        for (size_t i = 0; i < owners.size(); ++i) {
+            env->SetObjectArrayElement(owners_array, static_cast<jsize>(i), owners[i]);
         }
-        return abort_and_return();
     }
 
-    // --- Box Return Value ---
-    jobject value = nullptr;
-    switch (shorty_char[0]) {
-    case 'I':
-        value = env->CallStaticObjectMethod(cls_Integer, set_int, ret_val.i);
-        break;
-    case 'D':
-        value = env->CallStaticObjectMethod(cls_Double, set_double, ret_val.d);
-        break;
-    case 'J':
-        value = env->CallStaticObjectMethod(cls_Long, set_long, ret_val.j);
-        break;
-    case 'F':
-        value = env->CallStaticObjectMethod(cls_Float, set_float, ret_val.f);
-        break;
-    case 'S':
-        value = env->CallStaticObjectMethod(cls_Short, set_short, ret_val.s);
-        break;
-    case 'B':
-        value = env->CallStaticObjectMethod(cls_Byte, set_byte, ret_val.b);
-        break;
-    case 'C':
-        value = env->CallStaticObjectMethod(cls_Character, set_char, ret_val.c);
-        break;
-    case 'Z':
-        value = env->CallStaticObjectMethod(cls_Boolean, set_boolean, ret_val.z);
-        break;
-    case 'L':
-        value = ret_val.l;
-        break;
-    case 'V':
-        value = nullptr;
-        break;
-    }
+    auto result = env->NewObjectArray(3, object_class, nullptr);
+    if (!result) return nullptr;
+    env->SetObjectArrayElement(result, 0, stats_array);
+    env->SetObjectArrayElement(result, 1, methods_array);
+    env->SetObjectArrayElement(result, 2, owners_array);
+    return result;
+}
+
+/**
+ * @brief JNI wrapper around AllocObject.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobject, HookBridge, allocateObject, jclass cls) {
+    return env->AllocObject(cls);
+}
 
-    env->ReleaseCharArrayElements(shorty, shorty_char, JNI_ABORT);
-    return value;
+/**
+ * Core JNI backend for non-virtual method invocation and special object initialization.
+ *
+ * Implementation details:
+ * 1. Dispatches using JNI CallNonvirtual<Type>MethodA on [cls].
+ * 2. The shorty comes from the method's cached InvokePlan rather than from the caller.
+ * 3. Safely mirrors standard Java reflection (NPEs on null primitives/receivers).
+ * 4. Accurately catches and wraps target method exceptions into InvocationTargetException.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobject, HookBridge, invokeSpecialMethod, jobject method, jclass cls,
+                         jobject thiz, jobjectArray args) {
+    auto target = env->FromReflectedMethod(method);
+    auto *plan = GetInvokePlan(env, target, method);
+    if (!plan) return nullptr;
+    return Invoke(env, *plan, target, Dispatch::kNonvirtual, cls, thiz, args);
 }
 
 /**
@@ -596,57 +3484,411 @@ VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, makeFieldWritable, jobject field,
 }
 
 /**
- * @brief Creates a snapshot of all registered callbacks for a given method.
- * This is useful for debugging and introspection from the Java side.
+ * @brief The handle the typed field accessors below take for [field]: its jfieldID, which ART
+ * resolves to the field's offset and type without reflection's lookup, access check or boxing.
+ * Valid for as long as the field's class is loaded.
+ */
+VECTOR_DEF_NATIVE_METHOD(jlong, HookBridge, fieldHandle, jobject field) {
+    return static_cast<jlong>(reinterpret_cast<uintptr_t>(env->FromReflectedField(field)));
+}
+
+// Typed reads and writes by fieldHandle, one set per JNI type. They check nothing: the caller has
+// made sure the receiver is an instance of the declaring class, or is that class for a static
+// field, and that the type is the field's own.
+#define VECTOR_FIELD_ACCESSORS(Type, jtype)                                                        \
+    VECTOR_DEF_NATIVE_METHOD(jtype, HookBridge, get##Type##Field, jobject obj, jlong handle) {    \
+        return env->Get##Type##Field(obj, reinterpret_cast<jfieldID>(handle));                    \
+    }                                                                                              \
+    VECTOR_DEF_NATIVE_METHOD(void, HookBridge, set##Type##Field, jobject obj, jlong handle,       \
+                             jtype value) {                                                        \
+        env->Set##Type##Field(obj, reinterpret_cast<jfieldID>(handle), value);                     \
+    }                                                                                              \
+    VECTOR_DEF_NATIVE_METHOD(jtype, HookBridge, getStatic##Type##Field, jclass declaringClass,   \
+                             jlong handle) {                                                       \
+        return env->GetStatic##Type##Field(declaringClass, reinterpret_cast<jfieldID>(handle));   \
+    }                                                                                              \
+    VECTOR_DEF_NATIVE_METHOD(void, HookBridge, setStatic##Type##Field, jclass declaringClass,    \
+                             jlong handle, jtype value) {                                          \
+        env->SetStatic##Type##Field(declaringClass, reinterpret_cast<jfieldID>(handle), value);    \
+    }
 
+VECTOR_FIELD_ACCESSORS(Object, jobject)
+VECTOR_FIELD_ACCESSORS(Boolean, jboolean)
+VECTOR_FIELD_ACCESSORS(Byte, jbyte)
+VECTOR_FIELD_ACCESSORS(Char, jchar)
+VECTOR_FIELD_ACCESSORS(Short, jshort)
+VECTOR_FIELD_ACCESSORS(Int, jint)
+VECTOR_FIELD_ACCESSORS(Long, jlong)
+VECTOR_FIELD_ACCESSORS(Float, jfloat)
+VECTOR_FIELD_ACCESSORS(Double, jdouble)
+
+#undef VECTOR_FIELD_ACCESSORS
+
+/**
+ * @brief Returns the published snapshot of all registered callbacks for a given method.
+ *
+ * This runs on every call of every hooked method, so it takes no lock and allocates nothing: the
+ * arrays were built when the callbacks last changed, and every call shares them. Java must treat
+ * them as read-only.
+ *
  * @return An Object[2][] array where index 0 contains modern callbacks and
- *         index 1 contains legacy callbacks.
+ *         index 1 contains legacy callbacks, or nullptr if the method carries no callbacks.
  */
-VECTOR_DEF_NATIVE_METHOD(jobjectArray, HookBridge, callbackSnapshot, jclass callback_class,
-                         jobject method) {
+VECTOR_DEF_NATIVE_METHOD(jobjectArray, HookBridge, callbackSnapshot, jobject method) {
     auto target = env->FromReflectedMethod(method);
-    HookItem *hook_item = nullptr;
-    hooked_methods.if_contains(target,
-                               [&hook_item](const auto &it) { hook_item = it.second.get(); });
+    InstallDeferredHooks(env, target);
+    EpochDomain::Guard guard;
+    HookItem *hook_item = FindHookItem(target);
     if (!hook_item) return nullptr;
 
-    jobject backup = hook_item->GetBackup();
-    if (!backup) return nullptr;
+    if (!hook_item->GetBackup()) return nullptr;
+
+    return hook_item->LoadSnapshot(env);
+}
+
+/**
+ * @brief callbackSnapshot for a hooker, by the handle it was constructed with: one load through
+ * the handle in place of FromReflectedMethod and a registry lookup.
+ *
+ * [args] are the trampoline's arguments, receiver first unless [isStatic]. Callbacks whose filters
+ * reject them are left out, and nullptr means no callback wants this call at all.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobjectArray, HookBridge, handleCallbackSnapshot, jlong handle,
+                         jobjectArray args, jboolean isStatic) {
+    EpochDomain::Guard guard;
+    auto *hook_item = HookCell::FromHandle(handle)->item.load(std::memory_order_acquire);
+    if (!hook_item) return nullptr;
+
+    // @FastNative: an install still in progress is not waited for here.
+    if (!hook_item->PeekBackup()) return nullptr;
+
+    return hook_item->LoadSnapshot(env, args, isStatic);
+}
+
+/**
+ * @brief Restricts a registered callback to the calls whose arguments pass a filter, or lifts the
+ * restriction when [clauses] is null or empty.
+ *
+ * [clauses] holds three ints per clause: the CallbackFilter::Kind, the parameter index and, for
+ * kArgEqualsInt, the value. [constants] holds one element per clause: the Class for the instanceof
+ * kinds, the String for kArgEqualsString, null otherwise.
+ *
+ * @return JNI_TRUE when the callback was found and the filter is in effect for every later call.
+ */
+VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, setCallbackFilter, jboolean useModernApi,
+                         jobject hookMethod, jobject callback, jintArray clauses,
+                         jobjectArray constants) {
+    std::unique_ptr<CallbackFilter> filter;
+    const jsize clause_count = clauses ? env->GetArrayLength(clauses) / 3 : 0;
+    if (clause_count > 0) {
+        if (!constants || env->GetArrayLength(constants) < clause_count) return JNI_FALSE;
+        std::vector<jint> words(static_cast<size_t>(clause_count) * 3);
+        env->GetIntArrayRegion(clauses, 0, static_cast<jsize>(words.size()), words.data());
+        filter = std::make_unique<CallbackFilter>();
+        auto cleanup = [&] {
+            CallbackFilter::Delete(env, filter.release());
+            return JNI_FALSE;
+        };
+        for (jsize i = 0; i < clause_count; ++i) {
+            CallbackFilter::Clause clause{static_cast<CallbackFilter::Kind>(words[i * 3]),
+                                          words[i * 3 + 1], words[i * 3 + 2], nullptr, {}};
+            if (clause.kind < CallbackFilter::kArgIsNull ||
+                clause.kind > CallbackFilter::kThisInstanceOf || clause.index < 0) {
+                return cleanup();
+            }
+            auto constant = env->GetObjectArrayElement(constants, i);
+            if (constant) {
+                clause.constant = env->NewGlobalRef(constant);
+                env->DeleteLocalRef(constant);
+            }
+            if (clause.kind == CallbackFilter::kArgEqualsString) {
+                if (!clause.constant) return cleanup();
+                auto string = static_cast<jstring>(clause.constant);
+                clause.string.resize(static_cast<size_t>(env->GetStringLength(string)));
+                env->GetStringRegion(string, 0, static_cast<jsize>(clause.string.size()),
+                                     reinterpret_cast<jchar *>(clause.string.data()));
+            } else if ((clause.kind == CallbackFilter::kArgInstanceOf ||
+                        clause.kind == CallbackFilter::kThisInstanceOf) &&
+                       !clause.constant) {
+                return cleanup();
+            }
+            filter->clauses.push_back(std::move(clause));
+        }
+    }
+
+    auto target = env->FromReflectedMethod(hookMethod);
+    InstallDeferredHooks(env, target);
+    EpochDomain::Guard guard;
+    HookItem *hook_item = FindHookItem(target);
+    jobject backup = hook_item ? hook_item->GetBackup() : nullptr;
+    if (!backup) {
+        if (filter) CallbackFilter::Delete(env, filter.release());
+        return JNI_FALSE;
+    }
+
+    lsplant::JNIMonitor monitor(env, backup);
+    if (!hook_item->retired) {
+        auto &callbacks = useModernApi ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
+        for (auto &entry : callbacks) {
+            if (!env->IsSameObject(entry.object, callback)) continue;
+
+            auto &options = entry.Options();
+            const auto *previous = options.filter;
+            options.filter = filter.get();
+            if (!hook_item->PublishSnapshot(env)) {
+                options.filter = previous;
+                break;
+            }
+            filter.release();
+            // A call evaluating the previous snapshot may still be reading it.
+            if (previous) RetireFilter(env, previous);
+            return JNI_TRUE;
+        }
+    }
+    if (filter) CallbackFilter::Delete(env, filter.release());
+    return JNI_FALSE;
+}
+
+/**
+ * @brief Sets whether a registered callback stays out of calls to its method made while it is
+ * already running on the same thread, such as a toString the callback itself logs.
+ *
+ * Such a call skips the callback, and goes straight to the backup when no other callback wants it,
+ * so neither the recursion nor the cost of a nested dispatch happens. The callback still sees calls
+ * on other threads, and calls made once it has returned.
+ *
+ * @return JNI_TRUE when the callback was found and the setting is in effect for every later call.
+ */
+VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, setCallbackSkipsReentry, jboolean useModernApi,
+                         jobject hookMethod, jobject callback, jboolean skip) {
+    auto target = env->FromReflectedMethod(hookMethod);
+    InstallDeferredHooks(env, target);
+    EpochDomain::Guard guard;
+    HookItem *hook_item = FindHookItem(target);
+    jobject backup = hook_item ? hook_item->GetBackup() : nullptr;
+    if (!backup) return JNI_FALSE;
+
+    lsplant::JNIMonitor monitor(env, backup);
+    if (hook_item->retired) return JNI_FALSE;
+    auto &callbacks = useModernApi ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
+    for (auto &entry : callbacks) {
+        if (!env->IsSameObject(entry.object, callback)) continue;
+
+        auto &options = entry.Options();
+        const bool previous = options.skips_reentry;
+        options.skips_reentry = skip;
+        if (!hook_item->PublishSnapshot(env)) {
+            options.skips_reentry = previous;
+            return JNI_FALSE;
+        }
+        return JNI_TRUE;
+    }
+    return JNI_FALSE;
+}
+
+/**
+ * @brief Lets a registered callback see only a sample of the calls it accepts, or every one again
+ * when [kind] is 0.
+ *
+ * [kind] is a CallbackSampler::Kind and [value] its parameter: N for every Nth call, the chance out
+ * of 2^32 for a probability, the budget for a number of calls per second. The decision is taken
+ * natively, after the callback's filter, so a call left out of the sample never reaches Java on
+ * the callback's account. Observers are sampled before anything is captured.
+ *
+ * @return JNI_TRUE when the callback was found and the sampling is in effect for every later call.
+ */
+VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, setCallbackSampling, jboolean useModernApi,
+                         jobject hookMethod, jobject callback, jint kind, jlong value) {
+    std::unique_ptr<CallbackSampler> sampler;
+    if (kind != 0) {
+        if (kind < CallbackSampler::kEveryNth || kind > CallbackSampler::kPerSecond ||
+            value < 0 || (kind == CallbackSampler::kEveryNth && value == 0)) {
+            return JNI_FALSE;
+        }
+        sampler = std::make_unique<CallbackSampler>();
+        sampler->kind = static_cast<CallbackSampler::Kind>(kind);
+        sampler->value = static_cast<uint64_t>(value);
+    }
+
+    auto target = env->FromReflectedMethod(hookMethod);
+    InstallDeferredHooks(env, target);
+    EpochDomain::Guard guard;
+    HookItem *hook_item = FindHookItem(target);
+    jobject backup = hook_item ? hook_item->GetBackup() : nullptr;
+    if (!backup) return JNI_FALSE;
 
-    // Lock to ensure a consistent snapshot of the callback lists.
     lsplant::JNIMonitor monitor(env, backup);
+    if (hook_item->retired) return JNI_FALSE;
+    auto &callbacks = useModernApi ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
+    for (auto &entry : callbacks) {
+        if (!env->IsSameObject(entry.object, callback)) continue;
+
+        auto &options = entry.Options();
+        const auto *previous = options.sampler;
+        options.sampler = sampler.get();
+        if (!hook_item->PublishSnapshot(env)) {
+            options.sampler = previous;
+            return JNI_FALSE;
+        }
+        sampler.release();
+        // A call evaluating the previous snapshot may still be drawing from it.
+        if (previous) RetireSampler(env, previous);
+        return JNI_TRUE;
+    }
+    return JNI_FALSE;
+}
+
+/**
+ * @brief Sets whether a registered callback agrees to calls being answered from a memo table.
+ *
+ * While every callback on the method agrees, the first result for a tuple of arguments is
+ * remembered, and a later call with the same arguments gets it back from handleCallbackSnapshot
+ * without a chain being built or the original run. That suits the pure getters spoofing hooks
+ * rewrite. Changing any callback on the method forgets what was remembered; so does
+ * invalidateMemo. A method returning void has nothing to remember and is refused.
+ *
+ * @return JNI_TRUE when the callback was found and the setting is in effect for every later call.
+ */
+VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, setCallbackMemoizes, jboolean useModernApi,
+                         jobject hookMethod, jobject callback, jboolean memoize) {
+    auto target = env->FromReflectedMethod(hookMethod);
+    const auto *plan = GetInvokePlan(env, target, hookMethod);
+    if (!plan) {
+        env->ExceptionClear();
+        return JNI_FALSE;
+    }
+    if (memoize && plan->shorty[0] == 'V') return JNI_FALSE;
+
+    InstallDeferredHooks(env, target);
+    EpochDomain::Guard guard;
+    HookItem *hook_item = FindHookItem(target);
+    jobject backup = hook_item ? hook_item->GetBackup() : nullptr;
+    if (!backup) return JNI_FALSE;
 
-    // Get the generic Object class
-    jclass obj_class = env->FindClass("java/lang/Object");
+    lsplant::JNIMonitor monitor(env, backup);
+    if (hook_item->retired) return JNI_FALSE;
+    auto &callbacks = useModernApi ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
+    for (auto &entry : callbacks) {
+        if (!env->IsSameObject(entry.object, callback)) continue;
 
-    // Construct the result array Object[2][]
-    // Use an existing array to reliably get the Class for Object[]
-    jobjectArray dummy_array = env->NewObjectArray(0, obj_class, nullptr);
-    jclass obj_array_class = env->GetObjectClass(dummy_array);
-    jobjectArray res = env->NewObjectArray(2, obj_array_class, nullptr);
+        if (memoize) hook_item->EnableMemo(plan->shorty);
+        auto &options = entry.Options();
+        const bool previous = options.memoizes;
+        options.memoizes = memoize;
+        if (!hook_item->PublishSnapshot(env)) {
+            options.memoizes = previous;
+            return JNI_FALSE;
+        }
+        return JNI_TRUE;
+    }
+    return JNI_FALSE;
+}
 
-    // Create modern and legacy arrays
-    // Use 'callback_class' (VectorHookRecord) for the modern array for strict type safety
-    jobjectArray modern =
-        env->NewObjectArray((jsize)hook_item->modern_callbacks.size(), callback_class, nullptr);
-    jobjectArray legacy =
-        env->NewObjectArray((jsize)hook_item->legacy_callbacks.size(), obj_class, nullptr);
+/**
+ * @brief Forgets every result memoized for [hookMethod], for when what its getter reports changes.
+ * @return How many results were forgotten.
+ */
+VECTOR_DEF_NATIVE_METHOD(jint, HookBridge, invalidateMemo, jobject hookMethod) {
+    auto target = env->FromReflectedMethod(hookMethod);
+    EpochDomain::Guard guard;
+    HookItem *hook_item = FindHookItem(target);
+    return hook_item ? static_cast<jint>(hook_item->ClearMemo(env)) : 0;
+}
 
-    jsize i = 0;
-    for (const auto &callback_pair : hook_item->modern_callbacks) {
-        env->SetObjectArrayElement(modern, i++, callback_pair.second);
+/**
+ * @brief Makes a registered callback an observer, or an ordinary callback again when [receiver] is
+ * null.
+ *
+ * An observer stays out of the Java dispatch. Each call it accepts copies the values [captures]
+ * names, parameter indexes or ObserverSpec::kReceiver, into a bounded queue, and the thread in
+ * runObservers hands them to receiver.deliver(Object[]) later. A call that only observers want
+ * runs the backup directly. The callback's filter still applies; skipping reentrant calls does not,
+ * as nothing of the observer runs on the hooked thread.
+ *
+ * @return JNI_TRUE when the callback was found and the change is in effect for every later call.
+ */
+VECTOR_DEF_NATIVE_METHOD(jboolean, HookBridge, setCallbackObserver, jboolean useModernApi,
+                         jobject hookMethod, jobject callback, jobject receiver,
+                         jintArray captures) {
+    auto target = env->FromReflectedMethod(hookMethod);
+    std::unique_ptr<ObserverSpec> spec;
+    if (receiver) {
+        const jsize count = captures ? env->GetArrayLength(captures) : 0;
+        if (static_cast<size_t>(count) > ObserverSpec::kMaxCaptures) return JNI_FALSE;
+        const auto *plan = GetInvokePlan(env, target, hookMethod);
+        if (!plan) return JNI_FALSE;
+        spec = std::make_unique<ObserverSpec>();
+        spec->captures.resize(count);
+        if (count > 0) env->GetIntArrayRegion(captures, 0, count, spec->captures.data());
+        const auto parameter_count = static_cast<jint>(plan->shorty.size()) - 1;
+        for (jint index : spec->captures) {
+            if (index == ObserverSpec::kReceiver) {
+                if (plan->is_static) return JNI_FALSE;
+                spec->types.push_back('L');
+            } else if (index >= 0 && index < parameter_count) {
+                spec->types.push_back(plan->shorty[index + 1]);
+            } else {
+                return JNI_FALSE;
+            }
+        }
+        auto receiver_class = env->GetObjectClass(receiver);
+        spec->deliver = env->GetMethodID(receiver_class, "deliver", "([Ljava/lang/Object;)V");
+        env->DeleteLocalRef(receiver_class);
+        if (!spec->deliver) {
+            env->ExceptionClear();
+            return JNI_FALSE;
+        }
+        spec->receiver = env->NewGlobalRef(receiver);
     }
 
-    i = 0;
-    for (const auto &callback_pair : hook_item->legacy_callbacks) {
-        env->SetObjectArrayElement(legacy, i++, callback_pair.second);
+    InstallDeferredHooks(env, target);
+    EpochDomain::Guard guard;
+    HookItem *hook_item = FindHookItem(target);
+    jobject backup = hook_item ? hook_item->GetBackup() : nullptr;
+    auto discard = [&] {
+        if (spec) ObserverSpec::Delete(env, spec.release());
+        return JNI_FALSE;
+    };
+    if (!backup) return discard();
+
+    lsplant::JNIMonitor monitor(env, backup);
+    if (hook_item->retired) return discard();
+    auto &callbacks = useModernApi ? hook_item->modern_callbacks : hook_item->legacy_callbacks;
+    for (auto &entry : callbacks) {
+        if (!env->IsSameObject(entry.object, callback)) continue;
+
+        auto &options = entry.Options();
+        const auto *previous = options.observer;
+        options.observer = spec.get();
+        if (!hook_item->PublishSnapshot(env)) {
+            options.observer = previous;
+            break;
+        }
+        spec.release();
+        // A call in flight may still be capturing with the previous spec.
+        if (previous) RetireObserver(env, previous);
+        return JNI_TRUE;
     }
+    return discard();
+}
+
+/**
+ * @brief Delivers observer captures on the calling thread, and never returns; a second thread
+ * calling it returns at once. HookBridge starts one daemon thread for this.
+ */
+VECTOR_DEF_NATIVE_METHOD(void, HookBridge, runObservers) { ObserverQueue::Instance().Drain(env); }
 
-    env->SetObjectArrayElement(res, 0, modern);
-    env->SetObjectArrayElement(res, 1, legacy);
-    env->DeleteLocalRef(modern);
-    env->DeleteLocalRef(legacy);
-    return res;
+/**
+ * @brief How many observer captures have been delivered, and how many were dropped because the
+ * queue was full when the hooked call came.
+ */
+VECTOR_DEF_NATIVE_METHOD(jlongArray, HookBridge, observerStats) {
+    auto &queue = ObserverQueue::Instance();
+    const jlong values[] = {static_cast<jlong>(queue.Delivered()),
+                            static_cast<jlong>(queue.Dropped())};
+    auto result = env->NewLongArray(2);
+    if (result) env->SetLongArrayRegion(result, 0, 2, values);
+    return result;
 }
 
 /**
@@ -806,32 +4048,244 @@ VECTOR_DEF_NATIVE_METHOD(jobject, HookBridge, findStaticInitializer, jclass targ
     return nullptr;
 }
 
+/**
+ * @brief Lists every ArtMethod of a class as a reflected Executable, <clinit> included, without
+ * initializing the class.
+ *
+ * [methods] is the class's java.lang.Class.methods, the address of the LengthPrefixedArray ART
+ * keeps all of its methods in: direct ones, declared virtual ones and the ones copied in from
+ * interfaces. The array is a uint32_t length followed by the elements, [artMethodSize] bytes each,
+ * starting at the first offset past the length that is aligned for an ArtMethod.
+ *
+ * That offset is worked out once per process, from [anchors]: the ArtMethod addresses of members
+ * reflection shows for the same class. Until a call with anchors has confirmed it this returns
+ * nullptr, and later calls may pass null. Walking the array directly replaces probing gaps between
+ * the members reflection shows, which findStaticInitializer does for one method at a time.
+ *
+ * @return The executables in array order, nullptr when the layout is not the one this relies on.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobjectArray, HookBridge, getDeclaredExecutables, jclass target_class,
+                         jlong methods, jlong artMethodSize, jlongArray anchors) {
+    static std::atomic<int> data_offset{-1};
+    const auto stride = static_cast<uintptr_t>(artMethodSize);
+    if (stride < 16 || stride > 128 || (stride % alignof(void *)) != 0) return nullptr;
+
+    const auto array = static_cast<uintptr_t>(methods);
+    const jsize anchor_count = anchors ? env->GetArrayLength(anchors) : 0;
+    if (array != 0 && ((array % alignof(uint32_t)) != 0 || array < 0x1000)) return nullptr;
+
+    int offset = data_offset.load(std::memory_order_relaxed);
+    if (offset < 0) {
+        // Every anchor has to land on an element boundary inside the array at the offset tried.
+        if (array == 0 || anchor_count == 0) return nullptr;
+        std::vector<jlong> raw(anchor_count);
+        env->GetLongArrayRegion(anchors, 0, anchor_count, raw.data());
+        const uint32_t length = *reinterpret_cast<const uint32_t *>(array);
+        for (int candidate : {static_cast<int>(sizeof(void *)), 4, 8, 16}) {
+            const uintptr_t first = array + static_cast<uintptr_t>(candidate);
+            const bool fits = std::all_of(raw.begin(), raw.end(), [&](jlong anchor) {
+                const auto address = static_cast<uintptr_t>(anchor);
+                return address >= first && (address - first) % stride == 0 &&
+                       (address - first) / stride < length;
+            });
+            if (fits) {
+                offset = candidate;
+                break;
+            }
+        }
+        if (offset < 0) return nullptr;
+        data_offset.store(offset, std::memory_order_relaxed);
+    }
+
+    const uint32_t length = array ? *reinterpret_cast<const uint32_t *>(array) : 0;
+    // Dex method indices are 16 bits, and a class cannot declare more methods than that.
+    if (length > 0xffff) return nullptr;
+    auto result = env->NewObjectArray(static_cast<jsize>(length), executable_class, nullptr);
+    if (!result) return nullptr;
+
+    constexpr uint32_t kAccStatic = 0x0008;
+    const uintptr_t first = array + static_cast<uintptr_t>(offset);
+    for (uint32_t i = 0; i < length; ++i) {
+        const uintptr_t method = first + i * stride;
+        // ArtMethod starts with GcRoot<mirror::Class> declaring_class_, then access_flags_.
+        const uint32_t flags = *reinterpret_cast<const uint32_t *>(method + sizeof(uint32_t));
+        auto reflected = env->ToReflectedMethod(target_class, reinterpret_cast<jmethodID>(method),
+                                                (flags & kAccStatic) != 0);
+        if (!reflected) return nullptr;
+        env->SetObjectArrayElement(result, static_cast<jsize>(i), reflected);
+        env->DeleteLocalRef(reflected);
+    }
+    return result;
+}
+
+/**
+ * @brief Resolves members of [target_class] by name and JNI signature, all in one call.
+ *
+ * Each is looked up with GetMethodID or GetStaticMethodID, as [statics] says, and reflected with
+ * ToReflectedMethod, which skips the scan and the parameter matching of getDeclaredMethod. JNI
+ * also finds inherited members, so one whose declaring class is not [target_class] counts as not
+ * found, as it would for getDeclaredMethod.
+ *
+ * Resolving a method ID initializes its class, so this only serves classes that are initialized
+ * already: running a static initializer early is what a module resolving members in order to hook
+ * them must never cause.
+ *
+ * @return One element per member, null where it does not exist; or nullptr when [target_class] is
+ *         not known to be initialized, and the caller has to resolve through reflection.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobjectArray, HookBridge, resolveMembers, jclass target_class,
+                         jobjectArray names, jobjectArray signatures, jbooleanArray statics) {
+    const jsize count = names ? env->GetArrayLength(names) : 0;
+    if (!signatures || !statics || env->GetArrayLength(signatures) != count ||
+        env->GetArrayLength(statics) != count) {
+        env->ThrowNew(env->FindClass("java/lang/IllegalArgumentException"),
+                      "names, signatures and statics differ in length");
+        return nullptr;
+    }
+    if (!IsInitialized(env, target_class, false)) return nullptr;
+
+    std::vector<jboolean> is_static(count);
+    env->GetBooleanArrayRegion(statics, 0, count, is_static.data());
+    auto result = env->NewObjectArray(count, executable_class, nullptr);
+    if (!result) return nullptr;
+
+    for (jsize i = 0; i < count; ++i) {
+        auto name = static_cast<jstring>(env->GetObjectArrayElement(names, i));
+        auto signature = static_cast<jstring>(env->GetObjectArrayElement(signatures, i));
+        if (!name || !signature) {
+            env->ThrowNew(env->FindClass("java/lang/NullPointerException"),
+                          "null member name or signature");
+            return nullptr;
+        }
+        jmethodID id;
+        {
+            lsplant::JUTFString name_chars(env, name);
+            lsplant::JUTFString signature_chars(env, signature);
+            id = is_static[i] ? env->GetStaticMethodID(target_class, name_chars.get(),
+                                                       signature_chars.get())
+                              : env->GetMethodID(target_class, name_chars.get(),
+                                                 signature_chars.get());
+        }
+        env->DeleteLocalRef(name);
+        env->DeleteLocalRef(signature);
+        if (!id) {
+            // NoSuchMethodError: the member is reported missing rather than thrown.
+            env->ExceptionClear();
+            continue;
+        }
+
+        auto reflected = env->ToReflectedMethod(target_class, id, is_static[i]);
+        if (!reflected) return nullptr;
+        auto declaring_class = env->CallObjectMethod(reflected, get_declaring_class);
+        if (env->IsSameObject(declaring_class, target_class)) {
+            env->SetObjectArrayElement(result, i, reflected);
+        }
+        env->DeleteLocalRef(declaring_class);
+        env->DeleteLocalRef(reflected);
+    }
+    return result;
+}
+
+/**
+ * @brief Loads every class in [names] from [class_loader] in one call.
+ *
+ * Modules probe for optional classes by the dozen as each package loads; asking one at a time
+ * costs a JNI transition per name, and a ClassNotFoundException per absent one. Misses are
+ * remembered per loader by Context::FindClassesFromLoader, so the second probe is a set lookup.
+ *
+ * @return One element per name, null where the class is not found.
+ */
+VECTOR_DEF_NATIVE_METHOD(jobjectArray, HookBridge, findClasses, jobject class_loader,
+                         jobjectArray names) {
+    return Context::FindClassesFromLoader(env, class_loader, names);
+}
+
 // Array of native method descriptors for JNI registration.
 static JNINativeMethod gMethods[] = {
     VECTOR_NATIVE_METHOD(HookBridge, hookMethod,
                          "(ZLjava/lang/reflect/Executable;Ljava/lang/Class;ILjava/"
-                         "lang/Object;)Z"),
+                         "lang/Object;Ljava/lang/ClassLoader;)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, hookMethods,
+                         "(Z[Ljava/lang/reflect/Executable;Ljava/lang/Class;ILjava/"
+                         "lang/Object;Ljava/lang/ClassLoader;)[Z"),
     VECTOR_NATIVE_METHOD(HookBridge, unhookMethod,
                          "(ZLjava/lang/reflect/Executable;Ljava/lang/Object;)Z"),
     VECTOR_NATIVE_METHOD(HookBridge, replaceCallback,
                          "(ZLjava/lang/reflect/Executable;Ljava/lang/Object;Ljava/"
                          "lang/Object;I)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, updateCallbacks,
+                         "(Z[Ljava/lang/reflect/Executable;[Ljava/lang/Object;[Ljava/"
+                         "lang/Object;[I)[Z"),
     VECTOR_NATIVE_METHOD(HookBridge, deoptimizeMethod, "(Ljava/lang/reflect/Executable;)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, deoptimizeMethods, "([Ljava/lang/reflect/Executable;)[J"),
     VECTOR_NATIVE_METHOD(HookBridge, invokeOriginalMethod,
                          "(Ljava/lang/reflect/Executable;Ljava/lang/Object;[Ljava/"
                          "lang/Object;)Ljava/lang/Object;"),
+    VECTOR_NATIVE_METHOD(HookBridge, handleInvokeOriginal,
+                         "(JLjava/lang/reflect/Executable;Ljava/lang/Object;[Ljava/"
+                         "lang/Object;I)Ljava/lang/Object;"),
     VECTOR_NATIVE_METHOD(HookBridge, invokeSpecialMethod,
-                         "(Ljava/lang/reflect/Executable;[CLjava/lang/Class;Ljava/"
+                         "(Ljava/lang/reflect/Executable;Ljava/lang/Class;Ljava/"
                          "lang/Object;[Ljava/lang/Object;)Ljava/lang/Object;"),
+    VECTOR_NATIVE_METHOD(HookBridge, setIdleHookTimeout, "(J)V"),
+    VECTOR_NATIVE_METHOD(HookBridge, reclaimIdleHooks, "()I"),
+    VECTOR_NATIVE_METHOD(HookBridge, recordInvocation, "(Ljava/lang/reflect/Executable;JJ)V"),
+    VECTOR_NATIVE_METHOD(HookBridge, handleRecordInvocation, "(JJJJJILjava/lang/Object;Z)V"),
+    VECTOR_NATIVE_METHOD(HookBridge, beginDeferredHooks, "()V"),
+    VECTOR_NATIVE_METHOD(HookBridge, endDeferredHooks, "()[Ljava/lang/Object;"),
+    VECTOR_NATIVE_METHOD(HookBridge, startHookTrace, "(I)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, stopHookTrace, "()V"),
+    VECTOR_NATIVE_METHOD(HookBridge, hookStats, "()[Ljava/lang/Object;"),
     VECTOR_NATIVE_METHOD(HookBridge, allocateObject, "(Ljava/lang/Class;)Ljava/lang/Object;"),
     VECTOR_NATIVE_METHOD(HookBridge, instanceOf, "(Ljava/lang/Object;Ljava/lang/Class;)Z"),
     VECTOR_NATIVE_METHOD(HookBridge, setTrusted, "(Ljava/lang/Object;)Z"),
     VECTOR_NATIVE_METHOD(HookBridge, makeFieldWritable, "(Ljava/lang/reflect/Field;I)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, fieldHandle, "(Ljava/lang/reflect/Field;)J"),
+#define VECTOR_FIELD_ACCESSORS(Type, signature)                                                    \
+    VECTOR_NATIVE_METHOD(HookBridge, get##Type##Field, "(Ljava/lang/Object;J)" signature),        \
+        VECTOR_NATIVE_METHOD(HookBridge, set##Type##Field, "(Ljava/lang/Object;J" signature ")V"), \
+        VECTOR_NATIVE_METHOD(HookBridge, getStatic##Type##Field,                                  \
+                             "(Ljava/lang/Class;J)" signature),                                   \
+        VECTOR_NATIVE_METHOD(HookBridge, setStatic##Type##Field,                                  \
+                             "(Ljava/lang/Class;J" signature ")V")
+    VECTOR_FIELD_ACCESSORS(Object, "Ljava/lang/Object;"),
+    VECTOR_FIELD_ACCESSORS(Boolean, "Z"),
+    VECTOR_FIELD_ACCESSORS(Byte, "B"),
+    VECTOR_FIELD_ACCESSORS(Char, "C"),
+    VECTOR_FIELD_ACCESSORS(Short, "S"),
+    VECTOR_FIELD_ACCESSORS(Int, "I"),
+    VECTOR_FIELD_ACCESSORS(Long, "J"),
+    VECTOR_FIELD_ACCESSORS(Float, "F"),
+    VECTOR_FIELD_ACCESSORS(Double, "D"),
+#undef VECTOR_FIELD_ACCESSORS
     VECTOR_NATIVE_METHOD(HookBridge, callbackSnapshot,
-                         "(Ljava/lang/Class;Ljava/lang/reflect/"
-                         "Executable;)[[Ljava/lang/Object;"),
+                         "(Ljava/lang/reflect/Executable;)[[Ljava/lang/Object;"),
+    VECTOR_NATIVE_METHOD(HookBridge, handleCallbackSnapshot,
+                         "(J[Ljava/lang/Object;Z)[[Ljava/lang/Object;"),
+    VECTOR_NATIVE_METHOD(
+        HookBridge, setCallbackFilter,
+        "(ZLjava/lang/reflect/Executable;Ljava/lang/Object;[I[Ljava/lang/Object;)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, setCallbackSkipsReentry,
+                         "(ZLjava/lang/reflect/Executable;Ljava/lang/Object;Z)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, setCallbackMemoizes,
+                         "(ZLjava/lang/reflect/Executable;Ljava/lang/Object;Z)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, invalidateMemo, "(Ljava/lang/reflect/Executable;)I"),
+    VECTOR_NATIVE_METHOD(HookBridge, setCallbackSampling,
+                         "(ZLjava/lang/reflect/Executable;Ljava/lang/Object;IJ)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, setCallbackObserver,
+                         "(ZLjava/lang/reflect/Executable;Ljava/lang/Object;Ljava/lang/Object;"
+                         "[I)Z"),
+    VECTOR_NATIVE_METHOD(HookBridge, runObservers, "()V"),
+    VECTOR_NATIVE_METHOD(HookBridge, observerStats, "()[J"),
     VECTOR_NATIVE_METHOD(HookBridge, findStaticInitializer,
                          "(Ljava/lang/Class;[JJ)Ljava/lang/reflect/Executable;"),
+    VECTOR_NATIVE_METHOD(HookBridge, getDeclaredExecutables,
+                         "(Ljava/lang/Class;JJ[J)[Ljava/lang/reflect/Executable;"),
+    VECTOR_NATIVE_METHOD(HookBridge, resolveMembers,
+                         "(Ljava/lang/Class;[Ljava/lang/String;[Ljava/lang/String;[Z)[Ljava/lang/"
+                         "reflect/Executable;"),
+    VECTOR_NATIVE_METHOD(HookBridge, findClasses,
+                         "(Ljava/lang/ClassLoader;[Ljava/lang/String;)[Ljava/lang/Class;"),
     VECTOR_NATIVE_METHOD(HookBridge, legacyApiPrefixes, "()[Ljava/lang/String;"),
 };
 
@@ -843,7 +4297,37 @@ void RegisterHookBridge(JNIEnv *env) {
     jclass method = env->FindClass("java/lang/reflect/Method");
     invoke = env->GetMethodID(method, "invoke",
                               "(Ljava/lang/Object;[Ljava/lang/Object;)Ljava/lang/Object;");
+    // And what invoke plans read off the executables they are built from.
+    method_class = static_cast<jclass>(env->NewGlobalRef(method));
+    get_return_type = env->GetMethodID(method, "getReturnType", "()Ljava/lang/Class;");
     env->DeleteLocalRef(method);
+    jclass executable = env->FindClass("java/lang/reflect/Executable");
+    executable_class = static_cast<jclass>(env->NewGlobalRef(executable));
+    get_parameter_types = env->GetMethodID(executable, "getParameterTypes", "()[Ljava/lang/Class;");
+    get_declaring_class = env->GetMethodID(executable, "getDeclaringClass", "()Ljava/lang/Class;");
+    get_modifiers = env->GetMethodID(executable, "getModifiers", "()I");
+    env->DeleteLocalRef(executable);
+
+    // Cache the element types of the callback snapshots, which are built on every change.
+    jclass object = env->FindClass("java/lang/Object");
+    object_class = static_cast<jclass>(env->NewGlobalRef(object));
+    to_string_method = env->GetMethodID(object, "toString", "()Ljava/lang/String;");
+    jobjectArray empty = env->NewObjectArray(0, object, nullptr);
+    jclass object_array = env->GetObjectClass(empty);
+    object_array_class = static_cast<jclass>(env->NewGlobalRef(object_array));
+    env->DeleteLocalRef(object_array);
+    env->DeleteLocalRef(empty);
+    env->DeleteLocalRef(object);
+    Boxing::instance = new Boxing(env);
+
+    jclass string = env->FindClass("java/lang/String");
+    string_class = static_cast<jclass>(env->NewGlobalRef(string));
+    env->DeleteLocalRef(string);
+    jclass system = env->FindClass("java/lang/System");
+    system_class = static_cast<jclass>(env->NewGlobalRef(system));
+    identity_hash_code =
+        env->GetStaticMethodID(system, "identityHashCode", "(Ljava/lang/Object;)I");
+    env->DeleteLocalRef(system);
 
     REGISTER_VECTOR_NATIVE_METHODS(HookBridge);
 }
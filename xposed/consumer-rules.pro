@@ -11,6 +11,48 @@
 
 # Preserve the JNI Hook Trampoline
 -keepclassmembers class org.matrix.vector.impl.hooks.VectorNativeHooker {
-    public <init>(java.lang.reflect.Executable);
+    public <init>(java.lang.reflect.Executable, long);
     public java.lang.Object callback(java.lang.Object[]);
 }
+
+# Vector's extensions to the API, which modules reach by casting what the API hands them
+-keep class org.matrix.vector.impl.hooks.VectorHookHandle {
+    public void setFilter(org.matrix.vector.impl.hooks.VectorHookFilter);
+    public void setSkipReentrant(boolean);
+    public void setSampling(org.matrix.vector.impl.hooks.VectorHookSampling);
+    public void setMemoized(boolean);
+    public int invalidateMemo();
+}
+-keep class org.matrix.vector.impl.hooks.VectorHookFilter {
+    public <init>();
+    public <methods>;
+}
+-keep class org.matrix.vector.impl.hooks.VectorHookSampling {
+    public static <fields>;
+    public static <methods>;
+}
+-keep class org.matrix.vector.impl.hooks.VectorHookSampling$Companion {
+    public <methods>;
+}
+-keep class org.matrix.vector.impl.hooks.VectorHookBuilder {
+    public ** observe(org.matrix.vector.impl.hooks.VectorObserver, int[]);
+}
+-keep interface org.matrix.vector.impl.hooks.VectorObserver {
+    public static final int RECEIVER;
+    <methods>;
+}
+-keep class org.matrix.vector.impl.hooks.VectorObserver$Companion {
+    public <methods>;
+}
+-keep class org.matrix.vector.impl.utils.VectorMemberResolver {
+    public static <methods>;
+}
+-keep class org.matrix.vector.impl.utils.VectorMemberResolver$Member {
+    public <init>(...);
+    public <methods>;
+}
+
+# The observer thread calls deliver natively for every capture
+-keepclassmembers class org.matrix.vector.impl.hooks.VectorObserverDelivery {
+    public void deliver(java.lang.Object[]);
+}
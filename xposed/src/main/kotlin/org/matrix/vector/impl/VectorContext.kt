@@ -52,6 +52,50 @@ private val artMethodField: Field? by lazy {
         .getOrNull()
 }
 
+/** ART keeps the address of the array holding all of a class's ArtMethods in this field. */
+private val classMethodsField: Field? by lazy {
+    runCatching { Class::class.java.getDeclaredField("methods").apply { isAccessible = true } }
+        .getOrNull()
+}
+
+/**
+ * Whether the native side knows where the elements of a method array start, which it confirms once
+ * per process against Object, a class reflection shows every member of.
+ */
+private val methodArrayLayoutKnown: Boolean by lazy {
+    val field = artMethodField ?: return@lazy false
+    val methods = classMethodsField ?: return@lazy false
+    runCatching {
+            val origin = Any::class.java
+            val anchors =
+                (origin.declaredMethods.asList() + origin.declaredConstructors.asList())
+                    .map { field.getLong(it) }
+                    .toLongArray()
+            HookBridge.getDeclaredExecutables(
+                origin,
+                methods.getLong(origin),
+                artMethodSize,
+                anchors,
+            ) != null
+        }
+        .getOrDefault(false)
+}
+
+/**
+ * Every method ART holds for [origin] - the ones reflection hides, like <clinit>, and the ones
+ * copied in from interfaces included - read off its method array in one call without initializing
+ * it. Null when the array layout could not be confirmed.
+ */
+private fun declaredExecutables(origin: Class<*>): Array<Executable>? {
+    val methods = classMethodsField ?: return null
+    if (!methodArrayLayoutKnown) return null
+    return runCatching {
+            HookBridge.getDeclaredExecutables(origin, methods.getLong(origin), artMethodSize, null)
+        }
+        .onFailure { Log.w(TAG, "Cannot list the methods of ${origin.name}", it) }
+        .getOrNull()
+}
+
 /**
  * Main framework context implementation. Provides modules with capabilities to hook executables,
  * request invokers, and interact with the system.
@@ -131,10 +175,15 @@ class VectorContext(
      * on it exists to observe, so locate it from the method layout instead. Reflection over
      * declared members does not initialize the class, and ArtMethod addresses are read from the
      * reflected objects rather than through jmethodIDs, which a debuggable process hands out as
-     * indices.
+     * indices. The class's method array is read directly when its layout is known, and the gaps
+     * between the members reflection shows are searched otherwise.
      */
-    private fun findStaticInitializer(origin: Class<*>): Executable? =
-        runCatching {
+    private fun findStaticInitializer(origin: Class<*>): Executable? {
+        declaredExecutables(origin)?.let { all ->
+            return all.firstOrNull { it is Constructor<*> && Modifier.isStatic(it.modifiers) }
+        }
+        // The method array could not be read directly, so look for the gap <clinit> leaves.
+        return runCatching {
                 val field = artMethodField ?: return null
                 val members = ArrayList<Executable>()
                 members.addAll(origin.declaredConstructors)
@@ -147,6 +196,7 @@ class VectorContext(
             }
             .onFailure { Log.w(TAG, "Static initializer lookup failed for ${origin.name}", it) }
             .getOrNull()
+    }
 
     override fun deoptimize(executable: Executable): Boolean {
         return HookBridge.deoptimizeMethod(executable)
@@ -20,27 +20,45 @@ object VectorDeopter {
 
         val searchClassLoader = cl ?: ClassLoader.getSystemClassLoader()
 
-        for (target in targets) {
-            runCatching {
-                    val clazz = Class.forName(target.className, false, searchClassLoader)
-                    val executable: Executable =
-                        if (target.isConstructor) {
-                            clazz.getDeclaredConstructor(*target.params)
-                        } else {
-                            clazz.getDeclaredMethod(target.methodName, *target.params)
-                        }
-
-                    // Allow access if restricted and pass to the native bridge
-                    executable.isAccessible = true
-                    HookBridge.deoptimizeMethod(executable)
-                }
-                .onFailure {
-                    Log.v(
-                        TAG,
-                        "Skipping deopt for ${target.className}#${target.methodName}: ${it.message}",
-                    )
-                }
+        val executables =
+            targets.mapNotNull { target ->
+                runCatching {
+                        val clazz = Class.forName(target.className, false, searchClassLoader)
+                        val executable: Executable =
+                            if (target.isConstructor) {
+                                clazz.getDeclaredConstructor(*target.params)
+                            } else {
+                                clazz.getDeclaredMethod(target.methodName, *target.params)
+                            }
+
+                        // Allow access if restricted and pass to the native bridge
+                        executable.isAccessible = true
+                        executable
+                    }
+                    .onFailure {
+                        Log.v(
+                            TAG,
+                            "Skipping deopt for ${target.className}#${target.methodName}: ${it.message}",
+                        )
+                    }
+                    .getOrNull()
+            }
+        if (executables.isEmpty()) return
+
+        // One native call for the whole list, which also says what each deoptimization cost.
+        val elapsed = HookBridge.deoptimizeMethods(executables.toTypedArray())
+        executables.forEachIndexed { i, executable ->
+            if (elapsed[i] < 0) {
+                Log.v(TAG, "Could not deoptimize $executable")
+            } else {
+                Log.v(TAG, "Deoptimized $executable in ${elapsed[i] / 1000}us")
+            }
         }
+        Log.d(
+            TAG,
+            "Deoptimized ${elapsed.count { it >= 0 }}/${executables.size} methods for $where in " +
+                "${elapsed.filter { it >= 0 }.sum() / 1000}us",
+        )
     }
 
     fun deoptBootMethods() {
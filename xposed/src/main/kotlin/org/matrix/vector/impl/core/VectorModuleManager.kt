@@ -20,7 +20,9 @@ import org.matrix.vector.util.Log
 import org.matrix.vector.impl.VectorContext
 import org.matrix.vector.impl.VectorLifecycleManager
 import org.matrix.vector.impl.hooks.VectorHookBuilder
+import org.matrix.vector.impl.hooks.VectorHookHandle
 import org.matrix.vector.impl.utils.VectorModuleClassLoader
+import org.matrix.vector.nativebridge.HookBridge
 import org.matrix.vector.nativebridge.NativeAPI
 
 /**
@@ -313,12 +315,17 @@ object VectorModuleManager {
 
         var failure: Throwable? = null
         // The default onHotReloaded already unhooks these; doing both would double-unhook.
-        newEntries
-            .filter { VectorLifecycleManager.isActive(it) }
-            .forEach {
+        val reloadedEntries = newEntries.filter { VectorLifecycleManager.isActive(it) }
+        if (reloadedEntries.isNotEmpty() && reloadedEntries.none { overridesOnHotReloaded(it) }) {
+            // All the default would do is unhook the old handles one at a time, which for a module
+            // with hundreds of hooks is a visible stall. Unhook them in one batch instead.
+            VectorHookHandle.unhookAll(oldHandles)
+        } else {
+            reloadedEntries.forEach {
                 if (failure != null) return@forEach
                 runCatching { it.onHotReloaded(reloadedParam) }.onFailure { t -> failure = t }
             }
+        }
 
         // The last framework-owned reference to the old generation goes with this frame: its map
         // entry is gone, its entries are out of activeModules, and oldEntries dies on return.
@@ -327,10 +334,24 @@ object VectorModuleManager {
             return failed(describe(it), generationChanged = true)
         }
 
+        // Trampolines the previous reload left without callbacks have had a reload's worth of
+        // time to be hooked again; the ones that were not are only slowing their methods down.
+        HookBridge.reclaimIdleHooks()
+
         Log.d(TAG, "Hot reloaded $packageName")
         return outcome(IXposedService.HOT_RELOAD_SUCCEEDED, null, generationChanged = true)
     }
 
+    /** Whether [entry] replaces the interface's default onHotReloaded with code of its own. */
+    private fun overridesOnHotReloaded(entry: XposedModule): Boolean =
+        runCatching {
+                !entry.javaClass
+                    .getMethod("onHotReloaded", HotReloadedParam::class.java)
+                    .declaringClass
+                    .isInterface
+            }
+            .getOrDefault(true)
+
     /**
      * Rejects saved state that the old generation created, which would otherwise keep the retired
      * classloader reachable through the new one. A shallow scan, as the API describes it: a
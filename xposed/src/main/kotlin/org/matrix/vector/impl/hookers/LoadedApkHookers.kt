@@ -10,6 +10,7 @@ import org.matrix.vector.util.Utils
 import org.matrix.vector.impl.VectorLifecycleManager
 import org.matrix.vector.impl.di.LegacyPackageInfo
 import org.matrix.vector.impl.di.VectorBootstrap
+import org.matrix.vector.impl.hooks.VectorDeferredHooks
 
 /** Safe reflection helper */
 private inline fun <reified T> Any.getFieldValue(name: String): T? {
@@ -135,12 +136,14 @@ object LoadedApkCreateAppFactoryHooker : XposedInterface.Hooker {
                 loadedApk.getFieldValue<String>("mPackageName") ?: appInfo.packageName
             val ctx = PackageContextHelper.resolve(loadedApk, apkPackageName)
 
-            VectorLifecycleManager.dispatchPackageLoaded(
-                ctx.packageName,
-                appInfo,
-                ctx.isFirstPackage,
-                defaultClassLoader,
-            )
+            VectorDeferredHooks.batch {
+                VectorLifecycleManager.dispatchPackageLoaded(
+                    ctx.packageName,
+                    appInfo,
+                    ctx.isFirstPackage,
+                    defaultClassLoader,
+                )
+            }
         }
 
         return chain.proceed()
@@ -168,33 +171,37 @@ object LoadedApkCreateCLHooker : XposedInterface.Hooker {
 
             val ctx = PackageContextHelper.resolve(loadedApk, apkPackageName)
 
-            // Dispatch Modern Lifecycle: onPackageReady
-            if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.P) {
-                val appComponentFactory = loadedApk.getFieldValue<Any>("mAppComponentFactory")
-                VectorLifecycleManager.dispatchPackageReady(
-                    ctx.packageName,
-                    appInfo,
-                    ctx.isFirstPackage,
-                    defaultClassLoader,
-                    classLoader,
-                    appComponentFactory,
-                )
-            }
+            // The app's own classes are not initialized yet, so hooks on them can wait for every
+            // module to have registered its own and then go in together.
+            VectorDeferredHooks.batch {
+                // Dispatch Modern Lifecycle: onPackageReady
+                if (Build.VERSION.SDK_INT >= Build.VERSION_CODES.P) {
+                    val appComponentFactory = loadedApk.getFieldValue<Any>("mAppComponentFactory")
+                    VectorLifecycleManager.dispatchPackageReady(
+                        ctx.packageName,
+                        appInfo,
+                        ctx.isFirstPackage,
+                        defaultClassLoader,
+                        classLoader,
+                        appComponentFactory,
+                    )
+                }
 
-            // Legacy API: Only dispatch once during initial load
-            if (isInitialLoad) {
-                val mIncludeCode = loadedApk.getFieldValue<Boolean>("mIncludeCode") ?: true
-                if (ctx.isFirstPackage || mIncludeCode) {
-                    VectorBootstrap.withLegacy { delegate ->
-                        delegate.onPackageLoaded(
-                            LegacyPackageInfo(
-                                ctx.legacyPackageName,
-                                ctx.processName,
-                                classLoader,
-                                appInfo,
-                                ctx.isFirstPackage,
+                // Legacy API: Only dispatch once during initial load
+                if (isInitialLoad) {
+                    val mIncludeCode = loadedApk.getFieldValue<Boolean>("mIncludeCode") ?: true
+                    if (ctx.isFirstPackage || mIncludeCode) {
+                        VectorBootstrap.withLegacy { delegate ->
+                            delegate.onPackageLoaded(
+                                LegacyPackageInfo(
+                                    ctx.legacyPackageName,
+                                    ctx.processName,
+                                    classLoader,
+                                    appInfo,
+                                    ctx.isFirstPackage,
+                                )
                             )
-                        )
+                        }
                     }
                 }
             }
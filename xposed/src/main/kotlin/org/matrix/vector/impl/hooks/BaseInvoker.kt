@@ -33,21 +33,23 @@ internal abstract class BaseInvoker<T : Invoker<T, U>, U : Executable>(
             is Invoker.Type.Origin -> dispatchOriginal(thisObject, args)
             is Invoker.Type.Chain -> {
                 val snapshots =
-                    HookBridge.callbackSnapshot(VectorHookRecord::class.java, executable)
+                    HookBridge.callbackSnapshot(executable)
                         // The executable carries no hooks, so there is no chain to enter. Invokers
                         // default to Type.Chain.FULL, so this is the ordinary case for a module
                         // that obtains an invoker for a method it has not hooked.
                         ?: return dispatchOriginal(thisObject, args)
 
-                @Suppress("UNCHECKED_CAST")
-                val allModernHooks = snapshots[0] as Array<VectorHookRecord>
+                val allModernHooks = snapshots[0]
                 val legacyHooks = snapshots[1]
 
                 // Filter hooks to respect the maxPriority requested by the module
                 val filteredHooks =
-                    allModernHooks.filter { it.priority <= currentType.maxPriority }.toTypedArray()
+                    allModernHooks
+                        .filter { (it as VectorHookRecord).priority <= currentType.maxPriority }
+                        .toTypedArray()
 
-                val terminal: (Any?, Array<Any?>) -> Any? = { tObj, tArgs ->
+                val terminal: (Any?, Array<Any?>, Int) -> Any? = { tObj, packedArgs, offset ->
+                    val tArgs = unpackArgs(packedArgs, offset)
                     val delegate = VectorBootstrap.delegate
                     if (legacyHooks.isNotEmpty() && delegate != null) {
                         delegate.processLegacyHook(executable, tObj, tArgs, legacyHooks) {
@@ -59,7 +61,15 @@ internal abstract class BaseInvoker<T : Invoker<T, U>, U : Executable>(
                 }
 
                 val chain =
-                    VectorChain(executable, thisObject, arrayOf(*args), filteredHooks, 0, terminal)
+                    VectorChain(
+                        executable,
+                        thisObject,
+                        arrayOf(*args),
+                        0,
+                        filteredHooks,
+                        0,
+                        terminal,
+                    )
                 // Chain#proceed is documented to hand hookers the exception itself, while
                 // Invoker#invoke is documented against Method#invoke, which reports it wrapped, so
                 // the wrapping belongs at this boundary rather than inside the chain. The paths
@@ -76,29 +86,10 @@ internal abstract class BaseInvoker<T : Invoker<T, U>, U : Executable>(
     }
 
     /** Invokes the original executable, reporting a target exception as Method#invoke does. */
-    private fun dispatchOriginal(thisObject: Any?, args: Array<out Any?>): Any? {
-        // invokeOriginalMethod dispatches through a cached Method.invoke id. For a hooked
-        // executable that is applied to lsplant's backup Method, which is correct. For an
-        // executable with no hook item at all it is applied to the reflected object we passed in
-        // — and if that is a Constructor, the id belongs to a different class. Route those
-        // through the non-virtual path instead, which is what invokeSpecial already uses.
-        if (
-            executable is Constructor<*> &&
-                HookBridge.callbackSnapshot(VectorHookRecord::class.java, executable) == null
-        ) {
-            requireNotNull(thisObject) {
-                "A constructor invoked as a method needs a receiver: $executable"
-            }
-            return HookBridge.invokeSpecialMethod(
-                executable,
-                getExecutableShorty(),
-                executable.declaringClass,
-                thisObject,
-                *args,
-            )
-        }
-        return HookBridge.invokeOriginalMethod(executable, thisObject, *args)
-    }
+    private fun dispatchOriginal(thisObject: Any?, args: Array<out Any?>): Any? =
+        // Hooked or not, constructor or method: the native side picks the dispatch from the
+        // executable's cached invocation plan.
+        HookBridge.invokeOriginalMethod(executable, thisObject, *args)
 
     /**
      * The chain terminal. Chain#proceed is documented to throw whatever the original executable
@@ -110,31 +101,6 @@ internal abstract class BaseInvoker<T : Invoker<T, U>, U : Executable>(
         } catch (e: InvocationTargetException) {
             throw e.cause ?: e
         }
-
-    /** Helper to generate the JNI shorty for non-virtual special invocations. */
-    protected fun getExecutableShorty(): CharArray {
-        val parameterTypes = executable.parameterTypes
-        val shorty = CharArray(parameterTypes.size + 1)
-        shorty[0] = getTypeShorty(if (executable is Method) executable.returnType else Void.TYPE)
-        for (i in 1..shorty.lastIndex) {
-            shorty[i] = getTypeShorty(parameterTypes[i - 1])
-        }
-        return shorty
-    }
-
-    private fun getTypeShorty(type: Class<*>): Char =
-        when (type) {
-            Int::class.javaPrimitiveType -> 'I'
-            Long::class.javaPrimitiveType -> 'J'
-            Float::class.javaPrimitiveType -> 'F'
-            Double::class.javaPrimitiveType -> 'D'
-            Boolean::class.javaPrimitiveType -> 'Z'
-            Byte::class.javaPrimitiveType -> 'B'
-            Char::class.javaPrimitiveType -> 'C'
-            Short::class.javaPrimitiveType -> 'S'
-            Void.TYPE -> 'V'
-            else -> 'L'
-        }
 }
 
 /** Invoker implementation specifically for [Method] types. */
@@ -148,7 +114,6 @@ internal class VectorMethodInvoker(method: Method) :
     override fun invokeSpecial(thisObject: Any, vararg args: Any?): Any? {
         return HookBridge.invokeSpecialMethod(
             executable,
-            getExecutableShorty(),
             executable.declaringClass,
             thisObject,
             *args,
@@ -172,7 +137,6 @@ internal class VectorCtorInvoker<T : Any>(constructor: Constructor<T>) :
     override fun invokeSpecial(thisObject: Any, vararg args: Any?): Any? {
         HookBridge.invokeSpecialMethod(
             executable,
-            getExecutableShorty(),
             executable.declaringClass,
             thisObject,
             *args,
@@ -199,7 +163,6 @@ internal class VectorCtorInvoker<T : Any>(constructor: Constructor<T>) :
         val obj = HookBridge.allocateObject(subClass)
         HookBridge.invokeSpecialMethod(
             executable,
-            getExecutableShorty(),
             executable.declaringClass,
             obj,
             *args,
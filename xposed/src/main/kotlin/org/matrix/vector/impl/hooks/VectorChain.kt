@@ -11,10 +11,10 @@ import org.matrix.vector.util.Utils
  * A registered hook configuration, stored natively by [HookBridge].
  *
  * Immutable, and that is what makes the chain snapshot based for free. Replacing a hook swaps this
- * whole object inside the native callback map rather than editing it, so an array
- * `callbackSnapshot` already copied for a call in flight keeps pointing at the record that call
- * started with. Making the hooker mutable instead would force every hooked call to freeze a hooker
- * array of its own, which is an allocation on the hottest path in the framework.
+ * whole object inside the native callback map rather than editing it, so the snapshot array a call
+ * in flight already loaded keeps pointing at the record that call started with. Making the hooker
+ * mutable instead would force every hooked call to freeze a hooker array of its own, which is an
+ * allocation on the hottest path in the framework.
  */
 class VectorHookRecord(
     val hooker: Hooker,
@@ -26,14 +26,23 @@ class VectorHookRecord(
 /**
  * Core interceptor chain engine. Manages recursive hook execution and enforces [ExceptionMode]
  * protections.
+ *
+ * [hooks] holds [VectorHookRecord]s. It is typed Object[] because it is usually the shared
+ * snapshot array built natively, which is never copied and never written to.
+ *
+ * The arguments are the elements of [args] from [argsOffset] on. A hooker passes the array its
+ * trampoline built, with the receiver in front, as it is; arguments a hooker proceeds with are its
+ * own array and start at 0. [terminal] is handed the pair in the same form, so a call whose
+ * arguments nobody replaced reaches the original without an array being copied.
  */
 class VectorChain(
     private val executable: Executable,
     private val thisObj: Any?,
     private val args: Array<Any?>,
-    private val hooks: Array<VectorHookRecord>,
+    private val argsOffset: Int,
+    private val hooks: Array<Any?>,
     private val hookIndex: Int,
-    private val terminal: (thisObj: Any?, args: Array<Any?>) -> Any?,
+    private val terminal: (thisObj: Any?, args: Array<Any?>, argsOffset: Int) -> Any?,
 ) : Chain {
 
     // Tracks if this specific chain node has forwarded execution downstream
@@ -48,32 +57,51 @@ class VectorChain(
 
     override fun getThisObject(): Any? = thisObj
 
-    override fun getArgs(): List<Any?> = Collections.unmodifiableList(args.toMutableList())
+    override fun getArgs(): List<Any?> =
+        Collections.unmodifiableList(unpackArgs(args, argsOffset).toMutableList())
 
-    override fun getArg(index: Int): Any? = args[index]
+    override fun getArg(index: Int): Any? {
+        // Without this a negative index would read the receiver in front of the arguments.
+        if (index < 0 || index >= args.size - argsOffset) {
+            throw ArrayIndexOutOfBoundsException(index)
+        }
+        return args[argsOffset + index]
+    }
 
-    override fun proceed(): Any? = internalProceed(thisObj, args)
+    override fun proceed(): Any? = internalProceed(thisObj, args, argsOffset)
 
-    override fun proceed(currentArgs: Array<Any?>): Any? = internalProceed(thisObj, currentArgs)
+    override fun proceed(currentArgs: Array<Any?>): Any? = internalProceed(thisObj, currentArgs, 0)
 
-    override fun proceedWith(thisObject: Any): Any? = internalProceed(thisObject, args)
+    override fun proceedWith(thisObject: Any): Any? = internalProceed(thisObject, args, argsOffset)
 
     override fun proceedWith(thisObject: Any, currentArgs: Array<Any?>): Any? =
-        internalProceed(thisObject, currentArgs)
+        internalProceed(thisObject, currentArgs, 0)
 
-    private fun internalProceed(thisObject: Any?, currentArgs: Array<Any?>): Any? {
+    private fun internalProceed(
+        thisObject: Any?,
+        currentArgs: Array<Any?>,
+        currentOffset: Int,
+    ): Any? {
         proceedCalled = true
 
         // Reached the end of the modern hooks; trigger the original executable (and legacy hooks)
         if (hookIndex >= hooks.size) {
-            return executeDownstream { terminal(thisObject, currentArgs) }
+            return executeDownstream { terminal(thisObject, currentArgs, currentOffset) }
         }
 
-        val record = hooks[hookIndex]
+        val record = hooks[hookIndex] as VectorHookRecord
         val hooker = record.hooker
         val exceptionMode = record.exceptionMode
         val nextChain =
-            VectorChain(executable, thisObject, currentArgs, hooks, hookIndex + 1, terminal)
+            VectorChain(
+                executable,
+                thisObject,
+                currentArgs,
+                currentOffset,
+                hooks,
+                hookIndex + 1,
+                terminal,
+            )
 
         return try {
             executeDownstream { hooker.intercept(nextChain) }
@@ -86,6 +114,7 @@ class VectorChain(
                     nextChain,
                     thisObject,
                     currentArgs,
+                    currentOffset,
                 )
             }
         }
@@ -116,6 +145,7 @@ class VectorChain(
         nextChain: VectorChain,
         recoveryThis: Any?,
         recoveryArgs: Array<Any?>,
+        recoveryOffset: Int,
     ): Any? {
         // Check if the exception originated from downstream (lower hooks or original method)
         if (nextChain.proceedCalled && t === nextChain.downstreamThrowable) {
@@ -131,7 +161,7 @@ class VectorChain(
         if (!nextChain.proceedCalled) {
             // Crash occurred before calling proceed(); skip hooker and continue the chain
             Utils.logD("Hooker [$hookerName] crashed before proceed. Skipping.", t)
-            return nextChain.internalProceed(recoveryThis, recoveryArgs)
+            return nextChain.internalProceed(recoveryThis, recoveryArgs, recoveryOffset)
         } else {
             // Crash occurred after calling proceed(); suppress and restore downstream state
             Utils.logD("Hooker [$hookerName] crashed after proceed. Restoring state.", t)
@@ -140,3 +170,7 @@ class VectorChain(
         }
     }
 }
+
+/** The arguments of a [VectorChain] pair as an array of their own, copied only when it must be. */
+internal fun unpackArgs(args: Array<Any?>, argsOffset: Int): Array<Any?> =
+    if (argsOffset == 0) args else args.copyOfRange(argsOffset, args.size)
@@ -0,0 +1,47 @@
+package org.matrix.vector.impl.hooks
+
+import org.matrix.vector.nativebridge.HookBridge
+import org.matrix.vector.util.Utils
+
+/**
+ * Batches the hooks modules register while the framework hands them control on the cold-start
+ * path.
+ *
+ * Inside [batch], a hook the calling thread places on a method whose class has not been initialized
+ * yet is queued natively rather than installed. The queue is installed when the thread's outermost
+ * batch ends, one trampoline and one publication per method however many modules hooked it. Hooks
+ * on initialized classes, and hooks from any other thread, are installed right away as usual.
+ *
+ * Waiting is not free of risk. Another thread, or a module within the batch, may initialize a
+ * queued class and call into it before the batch ends, and those calls run without the queued
+ * hooks. Each method that happened to is logged when the batch is installed. This is why batches
+ * are kept to framework dispatches, which are short and run while the app's own classes are still
+ * untouched.
+ *
+ * A queued hook has already been reported as installed by the time it is, so one that fails to go
+ * in is taken back when the batch ends: its handle stops being valid and the owning module's log
+ * says so.
+ */
+object VectorDeferredHooks {
+
+    inline fun <T> batch(block: () -> T): T {
+        HookBridge.beginDeferredHooks()
+        try {
+            return block()
+        } finally {
+            HookBridge.endDeferredHooks()?.let { dropped(it) }
+        }
+    }
+
+    @PublishedApi
+    internal fun dropped(callbacks: Array<Any>) {
+        for (callback in callbacks) {
+            if (callback is VectorHookRecord) {
+                VectorHookRegistry.handleOf(callback)?.retireDropped()
+            } else {
+                // A legacy callback, whose Unhook holds nothing that could be invalidated.
+                Utils.logE("Deferred hook ${callback.javaClass.name} could not be installed")
+            }
+        }
+    }
+}
@@ -0,0 +1,50 @@
+package org.matrix.vector.impl.hooks
+
+/**
+ * Which calls of a hooked method a hooker wants to see, for [VectorHookHandle.setFilter].
+ *
+ * Every condition added must hold. Parameter indexes do not count the receiver. The conditions are
+ * evaluated natively before the hook chain is built, which is what makes a hook on a hot method that
+ * only cares about a few of its calls cheap for all the others.
+ */
+class VectorHookFilter {
+
+    private val clauses = ArrayList<Int>()
+    private val constants = ArrayList<Any?>()
+
+    private fun add(kind: Int, index: Int, value: Int = 0, constant: Any? = null) = apply {
+        require(index >= 0) { "Parameter index must not be negative: $index" }
+        clauses += kind
+        clauses += index
+        clauses += value
+        constants += constant
+    }
+
+    /** Parameter [index] is null. */
+    fun argIsNull(index: Int) = add(ARG_IS_NULL, index)
+
+    /** Parameter [index] is an instance of [type]. */
+    fun argInstanceOf(index: Int, type: Class<*>) = add(ARG_INSTANCE_OF, index, constant = type)
+
+    /** Parameter [index] is an int, boxed, equal to [value]. */
+    fun argEquals(index: Int, value: Int) = add(ARG_EQUALS_INT, index, value)
+
+    /** Parameter [index] is a String equal to [value]. */
+    fun argEquals(index: Int, value: String) = add(ARG_EQUALS_STRING, index, constant = value)
+
+    /** The receiver is an instance of [type]. Never holds for a static method. */
+    fun thisInstanceOf(type: Class<*>) = add(THIS_INSTANCE_OF, 0, constant = type)
+
+    internal fun clauses(): IntArray = clauses.toIntArray()
+
+    internal fun constants(): Array<Any?> = constants.toTypedArray()
+
+    private companion object {
+        // Shared with CallbackFilter::Kind in hook_bridge.cpp.
+        const val ARG_IS_NULL = 0
+        const val ARG_INSTANCE_OF = 1
+        const val ARG_EQUALS_INT = 2
+        const val ARG_EQUALS_STRING = 3
+        const val THIS_INSTANCE_OF = 4
+    }
+}
@@ -6,6 +6,7 @@ import io.github.libxposed.api.error.HookFailedError
 import java.lang.reflect.Executable
 import java.util.concurrent.ConcurrentHashMap
 import org.matrix.vector.nativebridge.HookBridge
+import org.matrix.vector.util.Utils
 
 /**
  * What the process remembers about the hooks a module has installed.
@@ -47,6 +48,10 @@ internal object VectorHookRegistry {
         byModule[moduleId]?.remove(handle)
     }
 
+    /** The live module handle that owns [record], if there is one. */
+    fun handleOf(record: VectorHookRecord): VectorHookHandle? =
+        byModule.values.firstNotNullOfOrNull { handles -> handles.find { it.record === record } }
+
     /** The hooks of [moduleId] that are still installed, for `HotReloadedParam#getOldHookHandles`. */
     fun liveHandles(moduleId: String): List<HookHandle> =
         byModule[moduleId]?.filter { it.isLive } ?: emptyList()
@@ -119,6 +124,113 @@ internal constructor(
         }
     }
 
+    /**
+     * Restricts this hook to the calls [filter] accepts, or lifts the restriction when it is null.
+     * A call no hooker on the method wants runs the original without a chain being set up.
+     *
+     * The filter stays with the registration when it is replaced through [replaceHook] or an id.
+     */
+    fun setFilter(filter: VectorHookFilter?) {
+        // The lock unhook and replaceHook take, so the record cannot change underneath.
+        synchronized(moduleId?.let { VectorHookRegistry.lockOf(it) } ?: this) {
+            if (!isLive) throw IllegalStateException("This hook handle is no longer valid")
+            if (
+                !HookBridge.setCallbackFilter(
+                    true,
+                    origin,
+                    record,
+                    filter?.clauses(),
+                    filter?.constants(),
+                )
+            ) {
+                throw HookFailedError("Cannot filter the hook on $origin")
+            }
+        }
+    }
+
+    /**
+     * Sets whether this hook stays out of calls to its method that happen while it is already
+     * running on the thread, for instance when the hooker logs the receiver of a hooked toString.
+     * Those calls run the original, or only the other hooks on the method.
+     *
+     * The setting stays with the registration when it is replaced through [replaceHook] or an id.
+     */
+    fun setSkipReentrant(skip: Boolean) {
+        synchronized(moduleId?.let { VectorHookRegistry.lockOf(it) } ?: this) {
+            if (!isLive) throw IllegalStateException("This hook handle is no longer valid")
+            if (!HookBridge.setCallbackSkipsReentry(true, origin, record, skip)) {
+                throw HookFailedError("Cannot change reentry of the hook on $origin")
+            }
+        }
+    }
+
+    /**
+     * Sets whether this hook agrees to calls of its method being answered from memory. Once every
+     * hook on the method agrees, the first result for each tuple of arguments is remembered and
+     * later calls with the same arguments return it natively, without any hooker or the original
+     * running; primitives and strings count by value, other objects by identity. Meant for hooks
+     * that rewrite pure getters, and refused for a method returning void.
+     *
+     * A method remembers at most 256 results. Once full, results for collected objects are dropped,
+     * and when too many are left, all of them are forgotten to make room.
+     *
+     * The setting stays with the registration when it is replaced through [replaceHook] or an id.
+     */
+    fun setMemoized(memoize: Boolean) {
+        synchronized(moduleId?.let { VectorHookRegistry.lockOf(it) } ?: this) {
+            if (!isLive) throw IllegalStateException("This hook handle is no longer valid")
+            if (!HookBridge.setCallbackMemoizes(true, origin, record, memoize)) {
+                throw HookFailedError("Cannot memoize the hook on $origin")
+            }
+        }
+    }
+
+    /**
+     * Forgets the results remembered for this hook's method, for when what the hook reports has
+     * changed, and returns how many there were.
+     */
+    fun invalidateMemo(): Int = HookBridge.invalidateMemo(origin)
+
+    /**
+     * Lets this hook see only the sample of its method's calls [sampling] describes, or every call
+     * again when it is null. A call left out runs the original, or only the other hooks on the
+     * method. An observer from [VectorHookBuilder.observe] is sampled before it captures anything.
+     *
+     * The sampling stays with the registration when it is replaced through [replaceHook] or an id.
+     */
+    fun setSampling(sampling: VectorHookSampling?) {
+        synchronized(moduleId?.let { VectorHookRegistry.lockOf(it) } ?: this) {
+            if (!isLive) throw IllegalStateException("This hook handle is no longer valid")
+            if (
+                !HookBridge.setCallbackSampling(
+                    true,
+                    origin,
+                    record,
+                    sampling?.kind ?: 0,
+                    sampling?.value ?: 0L,
+                )
+            ) {
+                throw HookFailedError("Cannot sample the hook on $origin")
+            }
+        }
+    }
+
+    /**
+     * Kills this handle because its deferred registration could not be installed after all, and
+     * tells the owning module, whose hook call had already returned it. There is nothing native to
+     * remove.
+     */
+    internal fun retireDropped() {
+        val moduleId = checkNotNull(moduleId)
+        synchronized(VectorHookRegistry.lockOf(moduleId)) {
+            if (!isLive) return
+            isLive = false
+            record.id?.let { VectorHookRegistry.releaseId(moduleId, origin, it, this) }
+            VectorHookRegistry.forget(moduleId, this)
+        }
+        Utils.logE("$moduleId: Cannot hook $origin; the handle returned for it is no longer valid")
+    }
+
     /**
      * Puts [replacement] where this handle's record is and hands the registration to a fresh handle.
      * Callers hold this module's lock, and [replacement] must carry this record's id.
@@ -141,4 +253,40 @@ internal constructor(
         replacement.id?.let { VectorHookRegistry.claimId(moduleId, origin, it, handle) }
         return handle
     }
+
+    companion object {
+        /**
+         * Does what [unhook] does to every handle in [handles], with one native call per module
+         * rather than a lookup, a lock and a republication per hook. Handles that are no longer
+         * live, or that Vector did not mint, are skipped.
+         */
+        internal fun unhookAll(handles: Collection<HookHandle>) {
+            handles
+                .filterIsInstance<VectorHookHandle>()
+                .groupBy { it.moduleId }
+                .forEach { (moduleId, group) ->
+                    if (moduleId == null) {
+                        group.forEach { it.unhook() }
+                        return@forEach
+                    }
+                    synchronized(VectorHookRegistry.lockOf(moduleId)) {
+                        val live = group.filter { it.isLive }
+                        live.forEach { handle ->
+                            handle.isLive = false
+                            handle.record.id?.let {
+                                VectorHookRegistry.releaseId(moduleId, handle.origin, it, handle)
+                            }
+                            VectorHookRegistry.forget(moduleId, handle)
+                        }
+                        HookBridge.updateCallbacks(
+                            true,
+                            Array(live.size) { live[it].origin },
+                            Array(live.size) { live[it].record },
+                            null,
+                            null,
+                        )
+                    }
+                }
+        }
+    }
 }
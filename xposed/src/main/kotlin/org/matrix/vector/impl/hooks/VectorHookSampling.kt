@@ -0,0 +1,40 @@
+package org.matrix.vector.impl.hooks
+
+/**
+ * Which share of the calls a hooker wants to see, for [VectorHookHandle.setSampling].
+ *
+ * Profiling hooks rarely need every call of a hot method. The sample is drawn natively after the
+ * hook's filter, before the hook chain is built, so a call left out of it costs about what a call
+ * the filter rejects does and never enters Java on this hook's account.
+ */
+class VectorHookSampling private constructor(internal val kind: Int, internal val value: Long) {
+
+    companion object {
+        // Shared with CallbackSampler::Kind in hook_bridge.cpp.
+        private const val EVERY_NTH = 1
+        private const val PROBABILITY = 2
+        private const val PER_SECOND = 3
+
+        /** Every [n]th call, counted across all threads, starting with the first. */
+        @JvmStatic
+        fun everyNth(n: Long): VectorHookSampling {
+            require(n > 0) { "n must be positive: $n" }
+            return VectorHookSampling(EVERY_NTH, n)
+        }
+
+        /** Each call independently, with chance [p]. */
+        @JvmStatic
+        fun probability(p: Double): VectorHookSampling {
+            require(p in 0.0..1.0) { "p must be between 0 and 1: $p" }
+            // The native side compares against 32 random bits.
+            return VectorHookSampling(PROBABILITY, (p * 4294967296.0).toLong())
+        }
+
+        /** The first [limit] calls in each second of the monotonic clock. */
+        @JvmStatic
+        fun perSecond(limit: Long): VectorHookSampling {
+            require(limit in 0..0xffffffffL) { "limit out of range: $limit" }
+            return VectorHookSampling(PER_SECOND, limit)
+        }
+    }
+}
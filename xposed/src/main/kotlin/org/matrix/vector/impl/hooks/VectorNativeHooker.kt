@@ -8,7 +8,6 @@ import io.github.libxposed.api.XposedInterface.Hooker
 import io.github.libxposed.api.error.HookFailedError
 import java.lang.reflect.Constructor
 import java.lang.reflect.Executable
-import java.lang.reflect.InvocationTargetException
 import java.lang.reflect.Method
 import java.lang.reflect.Modifier
 import org.matrix.vector.util.Utils
@@ -104,6 +103,36 @@ class VectorHookBuilder(
         }
     }
 
+    /**
+     * Installs [observer] on the method: it sees the values at parameter indexes [captures], or the
+     * receiver for [VectorObserver.RECEIVER], of every call, on the observer thread and after the
+     * fact. The priority and id apply as they do to [intercept]; the exception mode does not, since
+     * nothing of the observer runs inside the call.
+     */
+    fun observe(observer: VectorObserver, vararg captures: Int): HookHandle {
+        // Registered as a hooker that only proceeds, which is all a call sees of it until the
+        // native side has made it an observer.
+        val handle = intercept(PassThroughHooker) as VectorHookHandle
+        VectorObserverDelivery.ensureWorker()
+        if (
+            !HookBridge.setCallbackObserver(
+                true,
+                origin,
+                handle.record,
+                VectorObserverDelivery(origin, observer),
+                captures,
+            )
+        ) {
+            handle.unhook()
+            throw HookFailedError("Cannot observe $origin capturing ${captures.contentToString()}")
+        }
+        return handle
+    }
+
+    private object PassThroughHooker : Hooker {
+        override fun intercept(chain: XposedInterface.Chain): Any? = chain.proceed()
+    }
+
     private fun ensureNotFrozen() {
         if (frozen?.invoke() == true) {
             throw IllegalStateException(
@@ -121,6 +150,7 @@ class VectorHookBuilder(
                 VectorNativeHooker::class.java,
                 record.priority,
                 record,
+                record.hooker.javaClass.classLoader,
             )
         ) {
             throw HookFailedError("Cannot hook $origin")
@@ -151,44 +181,96 @@ class VectorHookBuilder(
 /**
  * The native callback entrypoint. Instantiated natively by [HookBridge] when a hooked method is
  * hit.
+ *
+ * [handle] names the hook to the native side for as long as this hooker can be called, so the
+ * per-call bridge calls take it instead of resolving [method] each time.
  */
-class VectorNativeHooker<T : Executable>(private val method: T) {
+class VectorNativeHooker<T : Executable>(private val method: T, private val handle: Long) {
 
     private val isStatic = Modifier.isStatic(method.modifiers)
     private val returnType = if (method is Method) method.returnType else null
 
-    /** Invoked by C++ via JNI. */
+    // The wrapper a primitive result has to come back in. The trampoline unboxes exactly this
+    // type, so a primitive method's result is checked with a class compare instead of a JNI call.
+    private val resultBox: Class<*>? =
+        returnType?.takeIf { it.isPrimitive && it != Void.TYPE }?.kotlin?.javaObjectType
+
+    /**
+     * Invoked by C++ via JNI.
+     *
+     * [args] is the array the trampoline built, with the receiver in front for an instance method.
+     * It is never unpacked into one of the arguments alone unless something needs that: the chain
+     * and the original both take it with an offset, and only legacy callbacks, which may write to
+     * the array they are given, get a copy.
+     */
     fun callback(args: Array<Any?>): Any? {
         val thisObject = if (isStatic) null else args[0]
-        val actualArgs = if (isStatic) args else args.sliceArray(1 until args.size)
+        val argsOffset = if (isStatic) 0 else 1
 
-        // Null means every hook was removed after this trampoline was entered.
+        // Null means no callback wants this call: every one was removed, and the trampoline is
+        // only waiting to be taken out, or every filter rejected the arguments.
         val snapshots =
-            HookBridge.callbackSnapshot(VectorHookRecord::class.java, method)
-                ?: return invokeOriginalSafely(thisObject, actualArgs)
+            HookBridge.handleCallbackSnapshot(handle, args, isStatic)
+                ?: return invokeOriginal(thisObject, args, argsOffset)
+
+        // Every hook on the method memoizes, and these arguments have been answered before.
+        if (snapshots.size == 1) return snapshots[0][0]
 
-        @Suppress("UNCHECKED_CAST") val modernHooks = snapshots[0] as Array<VectorHookRecord>
+        val modernHooks = snapshots[0]
         val legacyHooks = snapshots[1]
 
         // Fast path: No hooks active
         if (modernHooks.isEmpty() && legacyHooks.isEmpty()) {
-            return invokeOriginalSafely(thisObject, actualArgs)
+            return invokeOriginal(thisObject, args, argsOffset)
         }
 
-        val terminal: (Any?, Array<Any?>) -> Any? = { tObj, tArgs ->
+        // Timed for HookBridge.hookStats and the hook trace: the whole call, the part of it the
+        // original took, and how long it took to get there.
+        val start = System.nanoTime()
+        var originalNanos = 0L
+        var beforeNanos = -1L
+        val timedOriginal: (Any?, Array<Any?>, Int) -> Any? = { tObj, tArgs, tOffset ->
+            val originalStart = System.nanoTime()
+            if (beforeNanos < 0) beforeNanos = originalStart - start
+            try {
+                invokeOriginal(tObj, tArgs, tOffset)
+            } finally {
+                originalNanos += System.nanoTime() - originalStart
+            }
+        }
+
+        val terminal: (Any?, Array<Any?>, Int) -> Any? = { tObj, tArgs, tOffset ->
             val delegate = VectorBootstrap.delegate
             if (legacyHooks.isNotEmpty() && delegate != null) {
-                delegate.processLegacyHook(method, tObj, tArgs, legacyHooks) {
-                    invokeOriginalSafely(tObj, tArgs)
+                val legacyArgs = unpackArgs(tArgs, tOffset)
+                delegate.processLegacyHook(method, tObj, legacyArgs, legacyHooks) {
+                    timedOriginal(tObj, legacyArgs, 0)
                 }
             } else {
-                invokeOriginalSafely(tObj, tArgs)
+                timedOriginal(tObj, tArgs, tOffset)
             }
         }
 
-        val rootChain = VectorChain(method, thisObject, actualArgs, modernHooks, 0, terminal)
+        val rootChain = VectorChain(method, thisObject, args, argsOffset, modernHooks, 0, terminal)
 
-        val result = rootChain.proceed()
+        var result: Any? = null
+        var returned = false
+        try {
+            result = rootChain.proceed()
+            returned = true
+        } finally {
+            val totalNanos = System.nanoTime() - start
+            HookBridge.handleRecordInvocation(
+                handle,
+                start,
+                totalNanos,
+                originalNanos,
+                if (beforeNanos < 0) totalNanos else beforeNanos,
+                modernHooks.size + legacyHooks.size,
+                result,
+                returned,
+            )
+        }
 
         // Type safety validation before returning to C++
         if (returnType != null && returnType != Void.TYPE) {
@@ -198,12 +280,15 @@ class VectorNativeHooker<T : Executable>(private val method: T) {
                         "Hook returned null for a primitive return type: $method"
                     )
                 }
+            } else if (resultBox != null) {
+                if (result.javaClass != resultBox) {
+                    Utils.logD(
+                        "Hook return type mismatch. Expected ${returnType.name}, got ${result.javaClass.name}"
+                    )
+                }
             } else {
                 // Use the JNI bridge for the most reliable type check across ClassLoaders
-                if (
-                    !HookBridge.instanceOf(result, returnType) &&
-                        !isBoxingCompatible(result, returnType)
-                ) {
+                if (!HookBridge.instanceOf(result, returnType)) {
                     Utils.logD(
                         "Hook return type mismatch. Expected ${returnType.name}, got ${result.javaClass.name}"
                     )
@@ -214,28 +299,10 @@ class VectorNativeHooker<T : Executable>(private val method: T) {
         return result
     }
 
-    /** Handles primitive boxing compatibility (e.g., Integer object vs int primitive). */
-    private fun isBoxingCompatible(obj: Any, targetType: Class<*>): Boolean {
-        if (!targetType.isPrimitive) return false
-        return when (targetType) {
-            Int::class.javaPrimitiveType -> obj is Int
-            Long::class.javaPrimitiveType -> obj is Long
-            Boolean::class.javaPrimitiveType -> obj is Boolean
-            Double::class.javaPrimitiveType -> obj is Double
-            Float::class.javaPrimitiveType -> obj is Float
-            Byte::class.javaPrimitiveType -> obj is Byte
-            Char::class.javaPrimitiveType -> obj is Char
-            Short::class.javaPrimitiveType -> obj is Short
-            else -> false
-        }
-    }
-
-    /** Safely invokes the original method, unwrapping InvocationTargetExceptions. */
-    private fun invokeOriginalSafely(tObj: Any?, tArgs: Array<Any?>): Any? {
-        return try {
-            HookBridge.invokeOriginalMethod(method, tObj, *tArgs)
-        } catch (ite: InvocationTargetException) {
-            throw ite.cause ?: ite
-        }
-    }
+    /**
+     * Invokes the original method with the arguments of [tArgs] from [tOffset] on. What the
+     * original throws comes out as it is, not wrapped in an InvocationTargetException.
+     */
+    private fun invokeOriginal(tObj: Any?, tArgs: Array<Any?>, tOffset: Int): Any? =
+        HookBridge.handleInvokeOriginal(handle, method, tObj, tArgs, tOffset)
 }
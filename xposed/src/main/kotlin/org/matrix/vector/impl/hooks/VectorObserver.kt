@@ -0,0 +1,62 @@
+package org.matrix.vector.impl.hooks
+
+import java.lang.reflect.Executable
+import org.matrix.vector.nativebridge.HookBridge
+import org.matrix.vector.util.Utils
+
+/**
+ * A hook that only watches calls, for [VectorHookBuilder.observe].
+ *
+ * It cannot change arguments, results or exceptions, and in exchange it costs the hooked thread
+ * only a copy of the values it asked for: [onCall] runs later on Vector's observer thread, one call
+ * at a time in the order the calls were made. A captured primitive is copied by value; a captured
+ * object, the receiver included, costs a JNI global reference, which takes a process-wide lock, so
+ * capture only the objects [onCall] needs. Calls of all observers share one queue of 1024; when
+ * observers fall that far behind, new calls are dropped rather than queued, and [droppedCount] says
+ * how many.
+ */
+fun interface VectorObserver {
+
+    /**
+     * One observed call of [method]. [args] holds the values the hook captures, in the order they
+     * were named; a primitive comes boxed. References are the objects themselves, so a mutable
+     * argument may have changed since the call.
+     */
+    fun onCall(method: Executable, args: Array<Any?>)
+
+    companion object {
+        /** Captures the receiver, null for a static method, in place of a parameter index. */
+        const val RECEIVER = -1
+
+        /** Calls dropped so far because the observer queue was full. */
+        @JvmStatic fun droppedCount(): Long = HookBridge.observerStats()[1]
+    }
+}
+
+/** What the observer thread calls natively, through deliver, for every capture of [method]. */
+internal class VectorObserverDelivery(
+    private val method: Executable,
+    private val observer: VectorObserver,
+) {
+    fun deliver(args: Array<Any?>) {
+        try {
+            observer.onCall(method, args)
+        } catch (t: Throwable) {
+            Utils.logE("Observer ${observer.javaClass.name} on $method crashed", t)
+        }
+    }
+
+    companion object {
+        private val worker by lazy {
+            Thread(HookBridge::runObservers, "vector-observer").apply {
+                isDaemon = true
+                start()
+            }
+        }
+
+        /** Starts the observer thread if it is not running yet. */
+        fun ensureWorker() {
+            worker
+        }
+    }
+}
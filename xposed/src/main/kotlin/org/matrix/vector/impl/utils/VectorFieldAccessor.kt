@@ -0,0 +1,175 @@
+package org.matrix.vector.impl.utils
+
+import java.lang.reflect.Field
+import java.lang.reflect.Modifier
+import org.matrix.vector.nativebridge.HookBridge
+
+/**
+ * Typed reads and writes of one field, resolved once to a native handle.
+ *
+ * Modules read fields inside hooks all the time, and [Field.get] and friends redo the access check
+ * and box every primitive on each call. When the receiver is an instance of the declaring class and
+ * the requested type is the field's own, this goes to the field by JNI field ID instead. Anything
+ * else - a widening read, a value of the wrong type, a null receiver, a write to a final field -
+ * falls back to reflection, so the result and the exception are always the ones [Field] gives.
+ *
+ * A static field goes through reflection until one access has succeeded, since that is what
+ * initializes its class the way [Field.get] does; JNI would not.
+ */
+class VectorFieldAccessor private constructor(val field: Field) {
+
+    private val handle = HookBridge.fieldHandle(field)
+    private val type: Class<*> = field.type
+    private val declaringClass: Class<*> = field.declaringClass
+    private val isStatic = Modifier.isStatic(field.modifiers)
+    private val isFinal = Modifier.isFinal(field.modifiers)
+
+    @Volatile private var classInitialized = !isStatic
+
+    private fun direct(obj: Any?, requested: Class<*>?): Boolean =
+        type == requested &&
+            if (isStatic) classInitialized else obj != null && declaringClass.isInstance(obj)
+
+    private fun <T> reflect(read: () -> T): T = read().also { classInitialized = true }
+
+    @Throws(IllegalAccessException::class)
+    fun get(obj: Any?): Any? =
+        if (!type.isPrimitive && direct(obj, type)) {
+            if (isStatic) HookBridge.getStaticObjectField(declaringClass, handle)
+            else HookBridge.getObjectField(obj!!, handle)
+        } else reflect { field.get(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun set(obj: Any?, value: Any?) {
+        val assignable = !type.isPrimitive && (value == null || type.isInstance(value))
+        if (assignable && !isFinal && direct(obj, type)) {
+            if (isStatic) HookBridge.setStaticObjectField(declaringClass, handle, value)
+            else HookBridge.setObjectField(obj!!, handle, value)
+        } else reflect { field.set(obj, value) }
+    }
+
+    @Throws(IllegalAccessException::class)
+    fun getBoolean(obj: Any?): Boolean =
+        if (direct(obj, Boolean::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.getStaticBooleanField(declaringClass, handle)
+            else HookBridge.getBooleanField(obj!!, handle)
+        } else reflect { field.getBoolean(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun setBoolean(obj: Any?, value: Boolean) {
+        if (!isFinal && direct(obj, Boolean::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.setStaticBooleanField(declaringClass, handle, value)
+            else HookBridge.setBooleanField(obj!!, handle, value)
+        } else reflect { field.setBoolean(obj, value) }
+    }
+
+    @Throws(IllegalAccessException::class)
+    fun getByte(obj: Any?): Byte =
+        if (direct(obj, Byte::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.getStaticByteField(declaringClass, handle)
+            else HookBridge.getByteField(obj!!, handle)
+        } else reflect { field.getByte(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun setByte(obj: Any?, value: Byte) {
+        if (!isFinal && direct(obj, Byte::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.setStaticByteField(declaringClass, handle, value)
+            else HookBridge.setByteField(obj!!, handle, value)
+        } else reflect { field.setByte(obj, value) }
+    }
+
+    @Throws(IllegalAccessException::class)
+    fun getChar(obj: Any?): Char =
+        if (direct(obj, Char::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.getStaticCharField(declaringClass, handle)
+            else HookBridge.getCharField(obj!!, handle)
+        } else reflect { field.getChar(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun setChar(obj: Any?, value: Char) {
+        if (!isFinal && direct(obj, Char::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.setStaticCharField(declaringClass, handle, value)
+            else HookBridge.setCharField(obj!!, handle, value)
+        } else reflect { field.setChar(obj, value) }
+    }
+
+    @Throws(IllegalAccessException::class)
+    fun getShort(obj: Any?): Short =
+        if (direct(obj, Short::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.getStaticShortField(declaringClass, handle)
+            else HookBridge.getShortField(obj!!, handle)
+        } else reflect { field.getShort(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun setShort(obj: Any?, value: Short) {
+        if (!isFinal && direct(obj, Short::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.setStaticShortField(declaringClass, handle, value)
+            else HookBridge.setShortField(obj!!, handle, value)
+        } else reflect { field.setShort(obj, value) }
+    }
+
+    @Throws(IllegalAccessException::class)
+    fun getInt(obj: Any?): Int =
+        if (direct(obj, Int::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.getStaticIntField(declaringClass, handle)
+            else HookBridge.getIntField(obj!!, handle)
+        } else reflect { field.getInt(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun setInt(obj: Any?, value: Int) {
+        if (!isFinal && direct(obj, Int::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.setStaticIntField(declaringClass, handle, value)
+            else HookBridge.setIntField(obj!!, handle, value)
+        } else reflect { field.setInt(obj, value) }
+    }
+
+    @Throws(IllegalAccessException::class)
+    fun getLong(obj: Any?): Long =
+        if (direct(obj, Long::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.getStaticLongField(declaringClass, handle)
+            else HookBridge.getLongField(obj!!, handle)
+        } else reflect { field.getLong(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun setLong(obj: Any?, value: Long) {
+        if (!isFinal && direct(obj, Long::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.setStaticLongField(declaringClass, handle, value)
+            else HookBridge.setLongField(obj!!, handle, value)
+        } else reflect { field.setLong(obj, value) }
+    }
+
+    @Throws(IllegalAccessException::class)
+    fun getFloat(obj: Any?): Float =
+        if (direct(obj, Float::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.getStaticFloatField(declaringClass, handle)
+            else HookBridge.getFloatField(obj!!, handle)
+        } else reflect { field.getFloat(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun setFloat(obj: Any?, value: Float) {
+        if (!isFinal && direct(obj, Float::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.setStaticFloatField(declaringClass, handle, value)
+            else HookBridge.setFloatField(obj!!, handle, value)
+        } else reflect { field.setFloat(obj, value) }
+    }
+
+    @Throws(IllegalAccessException::class)
+    fun getDouble(obj: Any?): Double =
+        if (direct(obj, Double::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.getStaticDoubleField(declaringClass, handle)
+            else HookBridge.getDoubleField(obj!!, handle)
+        } else reflect { field.getDouble(obj) }
+
+    @Throws(IllegalAccessException::class)
+    fun setDouble(obj: Any?, value: Double) {
+        if (!isFinal && direct(obj, Double::class.javaPrimitiveType)) {
+            if (isStatic) HookBridge.setStaticDoubleField(declaringClass, handle, value)
+            else HookBridge.setDoubleField(obj!!, handle, value)
+        } else reflect { field.setDouble(obj, value) }
+    }
+
+    companion object {
+        /** An accessor for [field], which must already be accessible. */
+        @JvmStatic fun of(field: Field): VectorFieldAccessor = VectorFieldAccessor(field)
+    }
+}
@@ -0,0 +1,135 @@
+package org.matrix.vector.impl.utils
+
+import java.lang.reflect.Executable
+import java.lang.reflect.Modifier
+import java.util.Optional
+import java.util.concurrent.ConcurrentHashMap
+import org.matrix.vector.nativebridge.HookBridge
+
+/**
+ * Resolves methods and constructors by name and JNI signature, such as `("getInt",
+ * "(Ljava/lang/String;I)I")`, and caches them for the whole process.
+ *
+ * A batch resolves every member it misses in the cache with one native call, which looks each up
+ * by method ID instead of scanning the class the way getDeclaredMethod does. That only works on a
+ * class that is already initialized, because a JNI lookup would run the static initializer; any
+ * other class is resolved through reflection, so using this never initializes anything.
+ *
+ * Like getDeclaredMethod, only members [Class] declares itself are found. The results are not made
+ * accessible.
+ */
+object VectorMemberResolver {
+
+    /** One member to resolve. Constructors are named `<init>`. */
+    data class Member(val name: String, val signature: String, val isStatic: Boolean = false)
+
+    private data class Key(val clazz: Class<*>, val member: Member)
+
+    private val cache = ConcurrentHashMap<Key, Optional<Executable>>()
+
+    /** The member of [clazz] called [name] with [signature], or null if it declares none. */
+    @JvmStatic
+    @JvmOverloads
+    fun resolve(
+        clazz: Class<*>,
+        name: String,
+        signature: String,
+        isStatic: Boolean = false,
+    ): Executable? = resolveAll(clazz, listOf(Member(name, signature, isStatic)))[0]
+
+    /** The [members] of [clazz] in the same order, null for each it does not declare. */
+    @JvmStatic
+    fun resolveAll(clazz: Class<*>, members: List<Member>): List<Executable?> {
+        val results = arrayOfNulls<Executable>(members.size)
+        val missing = ArrayList<Int>()
+        members.forEachIndexed { i, member ->
+            val cached = cache[Key(clazz, member)]
+            if (cached != null) results[i] = cached.orElse(null) else missing.add(i)
+        }
+        if (missing.isEmpty()) return results.asList()
+
+        val resolved =
+            HookBridge.resolveMembers(
+                clazz,
+                Array(missing.size) { members[missing[it]].name },
+                Array(missing.size) { members[missing[it]].signature },
+                BooleanArray(missing.size) { members[missing[it]].isStatic },
+            )
+        missing.forEachIndexed { j, i ->
+            val member = members[i]
+            val executable = if (resolved != null) resolved[j] else reflect(clazz, member)
+            results[i] = executable
+            cache.putIfAbsent(Key(clazz, member), Optional.ofNullable(executable))
+        }
+        return results.asList()
+    }
+
+    private fun reflect(clazz: Class<*>, member: Member): Executable? {
+        val (parameters, returnType) =
+            parseSignature(member.signature, clazz.classLoader) ?: return null
+        return runCatching {
+                if (member.name == "<init>") {
+                    if (returnType != Void.TYPE || member.isStatic) return null
+                    clazz.getDeclaredConstructor(*parameters)
+                } else {
+                    clazz.getDeclaredMethod(member.name, *parameters).takeIf {
+                        it.returnType == returnType &&
+                            Modifier.isStatic(it.modifiers) == member.isStatic
+                    }
+                }
+            }
+            .getOrNull()
+    }
+
+    /** The parameter types and return type [signature] names, or null if one cannot be loaded. */
+    private fun parseSignature(
+        signature: String,
+        loader: ClassLoader?,
+    ): Pair<Array<Class<*>>, Class<*>>? {
+        if (!signature.startsWith('(')) return null
+        val types = ArrayList<Class<*>>()
+        var index = 1
+        var returnType: Class<*>? = null
+        while (index < signature.length) {
+            val isReturn = signature[index] == ')'
+            if (isReturn) index++
+            val start = index
+            while (index < signature.length && signature[index] == '[') index++
+            if (index >= signature.length) return null
+            if (signature[index] == 'L') {
+                index = signature.indexOf(';', index)
+                if (index < 0) return null
+            }
+            index++
+            val type = typeOf(signature.substring(start, index), loader) ?: return null
+            if (isReturn) {
+                returnType = type
+                break
+            }
+            types.add(type)
+        }
+        if (returnType == null || index != signature.length) return null
+        return types.toTypedArray() to returnType
+    }
+
+    private fun typeOf(descriptor: String, loader: ClassLoader?): Class<*>? =
+        when (descriptor) {
+            "Z" -> Boolean::class.javaPrimitiveType
+            "B" -> Byte::class.javaPrimitiveType
+            "C" -> Char::class.javaPrimitiveType
+            "S" -> Short::class.javaPrimitiveType
+            "I" -> Int::class.javaPrimitiveType
+            "J" -> Long::class.javaPrimitiveType
+            "F" -> Float::class.javaPrimitiveType
+            "D" -> Double::class.javaPrimitiveType
+            "V" -> Void.TYPE
+            else ->
+                runCatching {
+                        val name =
+                            if (descriptor.startsWith('[')) descriptor.replace('/', '.')
+                            else descriptor.substring(1, descriptor.length - 1).replace('/', '.')
+                        Class.forName(name, false, loader)
+                    }
+                    .getOrNull()
+        }
+}
@@ -5,8 +5,13 @@ import java.lang.reflect.Executable
 import java.lang.reflect.Field
 import java.lang.reflect.InvocationTargetException
 import java.lang.reflect.Method
+import org.matrix.vector.impl.hooks.VectorHookSampling
 
 object HookBridge {
+    /**
+     * Registers [callback] on [hookMethod]. [owner] is the class loader of the module the callback
+     * belongs to, which [hookStats] attributes the hook to.
+     */
     @JvmStatic
     external fun hookMethod(
         useModernApi: Boolean,
@@ -14,8 +19,24 @@ object HookBridge {
         hooker: Class<*>,
         priority: Int,
         callback: Any?,
+        owner: ClassLoader?,
     ): Boolean
 
+    /**
+     * Registers [callback] on every element of [hookMethods] in one native call, resolving
+     * [hooker] once for the whole batch. Each method succeeds or fails on its own; the result
+     * holds one entry per element, true where the callback was registered.
+     */
+    @JvmStatic
+    external fun hookMethods(
+        useModernApi: Boolean,
+        hookMethods: Array<Executable?>,
+        hooker: Class<*>,
+        priority: Int,
+        callback: Any?,
+        owner: ClassLoader?,
+    ): BooleanArray
+
     @JvmStatic
     external fun unhookMethod(
         useModernApi: Boolean,
@@ -24,12 +45,12 @@ object HookBridge {
     ): Boolean
 
     /**
-     * Swaps [oldCallback] for [newCallback] on [hookMethod] under the lock [callbackSnapshot]
-     * takes, so no snapshot can observe both or neither.
+     * Swaps [oldCallback] for [newCallback] on [hookMethod] in one publication of the snapshot
+     * [callbackSnapshot] returns, so no snapshot can observe both or neither.
      *
-     * A snapshot taken before this returns keeps running [oldCallback]: it copied the reference
-     * into an array of its own. That is what makes a replacement invisible to a call already in
-     * flight, which is what `HookHandle#replaceHook` promises.
+     * A snapshot taken before this returns keeps running [oldCallback]: it is an array of its own.
+     * That is what makes a replacement invisible to a call already in flight, which is what
+     * `HookHandle#replaceHook` promises.
      *
      * Returns false when [oldCallback] is no longer registered, which is the caller's cue that the
      * handle it holds has already been replaced or unhooked.
@@ -43,8 +64,125 @@ object HookBridge {
         newPriority: Int,
     ): Boolean
 
+    /**
+     * Removes or replaces many callbacks in one native call: [oldCallbacks]`[i]` on
+     * [methods]`[i]` is replaced by [newCallbacks]`[i]` at [newPriorities]`[i]`, or removed where
+     * [newCallbacks] or its element is null.
+     *
+     * Each affected hook is locked and republished once for the whole batch, which is what keeps
+     * retiring a module generation with hundreds of hooks from stalling the process. Returns one
+     * entry per element, true where the callback was found and changed.
+     */
+    @JvmStatic
+    external fun updateCallbacks(
+        useModernApi: Boolean,
+        methods: Array<Executable?>,
+        oldCallbacks: Array<Any?>,
+        newCallbacks: Array<Any?>?,
+        newPriorities: IntArray?,
+    ): BooleanArray
+
     @JvmStatic external fun deoptimizeMethod(method: Executable): Boolean
 
+    /**
+     * [deoptimizeMethod] for every element of [methods] in one call. Returns how long each took in
+     * nanoseconds, or -1 where the element was null or could not be deoptimized.
+     */
+    @JvmStatic external fun deoptimizeMethods(methods: Array<Executable?>): LongArray
+
+    /**
+     * How long a hooked method may keep its trampoline after its last callback is gone. While it
+     * waits, calls skip the hook chain and run the original; once it has waited this long, the
+     * hook is removed and the method runs at full speed again. Negative keeps idle hooks forever.
+     *
+     * The wait is what lets a hot reload unhook and hook the same methods again without paying for
+     * a new trampoline each time.
+     */
+    @JvmStatic external fun setIdleHookTimeout(timeoutMillis: Long)
+
+    /**
+     * Removes the hooks that have outlived the idle timeout now, rather than at the next
+     * [hookMethod] or [unhookMethod], and returns how many there were.
+     */
+    @JvmStatic external fun reclaimIdleHooks(): Int
+
+    /**
+     * Counts one hooked call of [method] that took [totalNanos], [originalNanos] of them in the
+     * original, towards [hookStats].
+     */
+    @JvmStatic
+    @FastNative
+    external fun recordInvocation(method: Executable, totalNanos: Long, originalNanos: Long)
+
+    /**
+     * [recordInvocation] for a hooker, by the handle it was constructed with. While a hook trace is
+     * running the call is also appended to it: it started at [startNanos] on [System.nanoTime]'s
+     * clock, reached the original after [beforeNanos] (all of [totalNanos] when it never did) and
+     * ran [callbacks] callbacks.
+     *
+     * [result] is what the call returned, when [returned]; a hook that memoizes remembers it for
+     * the call's arguments.
+     */
+    @JvmStatic
+    @FastNative
+    external fun handleRecordInvocation(
+        handle: Long,
+        startNanos: Long,
+        totalNanos: Long,
+        originalNanos: Long,
+        beforeNanos: Long,
+        callbacks: Int,
+        result: Any?,
+        returned: Boolean,
+    )
+
+    /**
+     * Opens a window in which [hookMethod] and [hookMethods], called on this thread, queue requests
+     * on methods whose class is not initialized yet, rather than installing each on the spot.
+     * Windows nest and belong to the thread that opened them. Use
+     * [org.matrix.vector.impl.hooks.VectorDeferredHooks.batch] rather than calling this directly.
+     */
+    @JvmStatic external fun beginDeferredHooks()
+
+    /**
+     * Closes a window [beginDeferredHooks] opened on this thread. The outermost one installs what
+     * the thread queued in one batch. Editing or unhooking a queued hook before then, from any
+     * thread, installs it first.
+     *
+     * Returns the callbacks of the queued requests that could not be installed, either way, or null
+     * when every one went in. [hookMethod] and [hookMethods] reported those as hooked, so the
+     * caller has to take back what it handed out for them.
+     */
+    @JvmStatic external fun endDeferredHooks(): Array<Any>?
+
+    /**
+     * Starts recording every hooked call of this process into a ring of [capacity] events in a
+     * memfd, which the daemon finds and reads on its own. The first start sizes the ring; a later
+     * one resumes it as it is. Returns false when the buffer could not be created.
+     *
+     * Methods are named here, and as they are hooked from then on, so it calls `toString` on each
+     * hooked method once; events of a method it has not reached yet carry no name.
+     */
+    @JvmStatic external fun startHookTrace(capacity: Int): Boolean
+
+    /** Stops recording into the hook trace, leaving what it holds for the daemon to read. */
+    @JvmStatic external fun stopHookTrace()
+
+    /**
+     * The counters of every hook called so far, as `{LongArray stats, Array methods, Array owners}`.
+     *
+     * `stats` opens with the number of histogram buckets `B` and the bound of the first bucket as a
+     * power of two, in nanoseconds; each bucket after it doubles the bound, and the last takes the
+     * rest. Then comes one record per element of `methods`, in order: invocations, nanoseconds in
+     * callbacks, the longest any one call spent in callbacks, nanoseconds in the original, the
+     * number `n` of owners with a callback on the hook, `n` indexes into `owners`, and `B`
+     * histogram counts of the time each call spent in callbacks.
+     *
+     * `owners` holds the class loaders given to [hookMethod], with null at index 0. Counters are
+     * summed across threads without stopping them, so a record can be a call or two out of step.
+     */
+    @JvmStatic external fun hookStats(): Array<Any?>?
+
     @JvmStatic
     @Throws(InstantiationException::class)
     external fun <T> allocateObject(clazz: Class<T>): T
@@ -57,6 +195,32 @@ object HookBridge {
     )
     external fun invokeOriginalMethod(method: Executable, thisObject: Any?, vararg args: Any?): Any?
 
+    /**
+     * [invokeOriginalMethod] for a hooker, which passes the handle it was constructed with so that
+     * [method] does not have to be looked up on every call.
+     *
+     * The arguments are the elements of [args] from [argsOffset] on, so a hooker can pass the array
+     * its trampoline built, receiver first, as it is. Not a vararg: spreading an array into one
+     * copies it.
+     *
+     * Unlike [invokeOriginalMethod], whatever the original throws is thrown as it is rather than
+     * wrapped in an [InvocationTargetException], which would only be built to be unwrapped again.
+     */
+    @JvmStatic
+    @Throws(IllegalAccessException::class, IllegalArgumentException::class)
+    external fun handleInvokeOriginal(
+        handle: Long,
+        method: Executable,
+        thisObject: Any?,
+        args: Array<Any?>,
+        argsOffset: Int,
+    ): Any?
+
+    /**
+     * Calls [method] on [thisObject] without virtual dispatch, as `invokespecial` would.
+     *
+     * The shorty is worked out natively the first time [method] is called and cached with it.
+     */
     @JvmStatic
     @Throws(
         IllegalAccessException::class,
@@ -65,7 +229,6 @@ object HookBridge {
     )
     external fun <T> invokeSpecialMethod(
         method: Executable,
-        shorty: CharArray,
         clazz: Class<T>,
         thisObject: Any?,
         vararg args: Any?,
@@ -91,13 +254,235 @@ object HookBridge {
      */
     @JvmStatic external fun makeFieldWritable(field: Field, modifiers: Int): Boolean
 
-    /** Returns null when [method] carries no hooks at all. */
+    /**
+     * A handle to [field] for the typed accessors below, which read and write it by JNI field ID:
+     * no reflective lookup, no access check and no boxing. Valid while the field's class is loaded.
+     *
+     * The accessors check nothing. The receiver must be an instance of the declaring class, or that
+     * class itself for the static ones, and the type must be the field's own; use
+     * [org.matrix.vector.impl.utils.VectorFieldAccessor], which makes sure of both.
+     */
+    @JvmStatic external fun fieldHandle(field: Field): Long
+
+    @JvmStatic @FastNative external fun getObjectField(obj: Any, handle: Long): Any?
+
+    @JvmStatic @FastNative external fun setObjectField(obj: Any, handle: Long, value: Any?)
+
+    @JvmStatic @FastNative external fun getStaticObjectField(clazz: Class<*>, handle: Long): Any?
+
     @JvmStatic
-    external fun callbackSnapshot(
-        hooker_callback: Class<*>,
-        method: Executable,
+    @FastNative
+    external fun setStaticObjectField(clazz: Class<*>, handle: Long, value: Any?)
+
+    @JvmStatic @FastNative external fun getBooleanField(obj: Any, handle: Long): Boolean
+
+    @JvmStatic @FastNative external fun setBooleanField(obj: Any, handle: Long, value: Boolean)
+
+    @JvmStatic @FastNative external fun getStaticBooleanField(clazz: Class<*>, handle: Long): Boolean
+
+    @JvmStatic
+    @FastNative
+    external fun setStaticBooleanField(clazz: Class<*>, handle: Long, value: Boolean)
+
+    @JvmStatic @FastNative external fun getByteField(obj: Any, handle: Long): Byte
+
+    @JvmStatic @FastNative external fun setByteField(obj: Any, handle: Long, value: Byte)
+
+    @JvmStatic @FastNative external fun getStaticByteField(clazz: Class<*>, handle: Long): Byte
+
+    @JvmStatic
+    @FastNative
+    external fun setStaticByteField(clazz: Class<*>, handle: Long, value: Byte)
+
+    @JvmStatic @FastNative external fun getCharField(obj: Any, handle: Long): Char
+
+    @JvmStatic @FastNative external fun setCharField(obj: Any, handle: Long, value: Char)
+
+    @JvmStatic @FastNative external fun getStaticCharField(clazz: Class<*>, handle: Long): Char
+
+    @JvmStatic
+    @FastNative
+    external fun setStaticCharField(clazz: Class<*>, handle: Long, value: Char)
+
+    @JvmStatic @FastNative external fun getShortField(obj: Any, handle: Long): Short
+
+    @JvmStatic @FastNative external fun setShortField(obj: Any, handle: Long, value: Short)
+
+    @JvmStatic @FastNative external fun getStaticShortField(clazz: Class<*>, handle: Long): Short
+
+    @JvmStatic
+    @FastNative
+    external fun setStaticShortField(clazz: Class<*>, handle: Long, value: Short)
+
+    @JvmStatic @FastNative external fun getIntField(obj: Any, handle: Long): Int
+
+    @JvmStatic @FastNative external fun setIntField(obj: Any, handle: Long, value: Int)
+
+    @JvmStatic @FastNative external fun getStaticIntField(clazz: Class<*>, handle: Long): Int
+
+    @JvmStatic
+    @FastNative
+    external fun setStaticIntField(clazz: Class<*>, handle: Long, value: Int)
+
+    @JvmStatic @FastNative external fun getLongField(obj: Any, handle: Long): Long
+
+    @JvmStatic @FastNative external fun setLongField(obj: Any, handle: Long, value: Long)
+
+    @JvmStatic @FastNative external fun getStaticLongField(clazz: Class<*>, handle: Long): Long
+
+    @JvmStatic
+    @FastNative
+    external fun setStaticLongField(clazz: Class<*>, handle: Long, value: Long)
+
+    @JvmStatic @FastNative external fun getFloatField(obj: Any, handle: Long): Float
+
+    @JvmStatic @FastNative external fun setFloatField(obj: Any, handle: Long, value: Float)
+
+    @JvmStatic @FastNative external fun getStaticFloatField(clazz: Class<*>, handle: Long): Float
+
+    @JvmStatic
+    @FastNative
+    external fun setStaticFloatField(clazz: Class<*>, handle: Long, value: Float)
+
+    @JvmStatic @FastNative external fun getDoubleField(obj: Any, handle: Long): Double
+
+    @JvmStatic @FastNative external fun setDoubleField(obj: Any, handle: Long, value: Double)
+
+    @JvmStatic @FastNative external fun getStaticDoubleField(clazz: Class<*>, handle: Long): Double
+
+    @JvmStatic
+    @FastNative
+    external fun setStaticDoubleField(clazz: Class<*>, handle: Long, value: Double)
+
+    /**
+     * The callbacks on [method], modern at index 0 and legacy at index 1, highest priority first.
+     *
+     * Built natively whenever the callbacks change and shared by every call until the next change,
+     * so this takes no lock and allocates nothing. The arrays must never be written to.
+     *
+     * Returns null when [method] carries no hooks at all.
+     */
+    @JvmStatic external fun callbackSnapshot(method: Executable): Array<Array<Any?>>?
+
+    /**
+     * [callbackSnapshot] for a hooker, by the handle it was constructed with. The handle leads
+     * straight to the hook, where [callbackSnapshot] has to resolve the method and look it up.
+     *
+     * [args] are the trampoline's arguments, receiver first unless [isStatic]. Callbacks whose
+     * [setCallbackFilter] filter rejects them are left out, and null means none wants this call.
+     * Hooks without filters get the shared arrays without the arguments being looked at.
+     *
+     * A single-element array instead is a memoized answer: its only element holds the one result,
+     * which the hooker returns without running anything. See [setCallbackMemoizes].
+     *
+     * Returning arrays rules out @CriticalNative, so this is @FastNative: it never blocks.
+     */
+    @JvmStatic
+    @FastNative
+    external fun handleCallbackSnapshot(
+        handle: Long,
+        args: Array<Any?>,
+        isStatic: Boolean,
     ): Array<Array<Any?>>?
 
+    /**
+     * Restricts [callback] on [hookMethod] to the calls whose arguments pass a filter, evaluated
+     * natively before any hook chain is set up; null or empty [clauses] lift the restriction.
+     *
+     * [clauses] holds three ints per clause: kind, parameter index and int operand. [constants]
+     * holds one element per clause: the Class or String operand, or null. The kinds are those of
+     * [org.matrix.vector.impl.hooks.VectorHookFilter].
+     *
+     * Returns false when [callback] is not registered or a clause is malformed.
+     */
+    @JvmStatic
+    external fun setCallbackFilter(
+        useModernApi: Boolean,
+        hookMethod: Executable,
+        callback: Any?,
+        clauses: IntArray?,
+        constants: Array<Any?>?,
+    ): Boolean
+
+    /**
+     * Sets whether [callback] on [hookMethod] is left out of calls to the method made while it is
+     * already running on the same thread. Such a call goes straight to the original when no other
+     * callback wants it, tracked natively, so the hooker needs no depth counter of its own.
+     *
+     * Returns false when [callback] is not registered.
+     */
+    @JvmStatic
+    external fun setCallbackSkipsReentry(
+        useModernApi: Boolean,
+        hookMethod: Executable,
+        callback: Any?,
+        skip: Boolean,
+    ): Boolean
+
+    /**
+     * Sets whether [callback] on [hookMethod] agrees to calls being answered from a memo table.
+     * While every callback on the method agrees, the first result for each tuple of arguments
+     * (primitives and strings by value, other objects by identity) is remembered, and later calls
+     * with the same arguments get it back from [handleCallbackSnapshot] without entering the chain.
+     * Any change to the method's callbacks forgets what was remembered, as does [invalidateMemo].
+     *
+     * Returns false when [callback] is not registered or the method returns void.
+     */
+    @JvmStatic
+    external fun setCallbackMemoizes(
+        useModernApi: Boolean,
+        hookMethod: Executable,
+        callback: Any?,
+        memoize: Boolean,
+    ): Boolean
+
+    /** Forgets every result memoized for [hookMethod] and returns how many there were. */
+    @JvmStatic external fun invalidateMemo(hookMethod: Executable): Int
+
+    /**
+     * Lets [callback] on [hookMethod] see only a sample of the calls its filter accepts, or every
+     * call again when [kind] is 0. [kind] and [value] are as [VectorHookSampling] encodes them. The
+     * sample is drawn natively, so a call left out never enters Java on the callback's account.
+     *
+     * Returns false when [callback] is not registered or the sampling is not valid.
+     */
+    @JvmStatic
+    external fun setCallbackSampling(
+        useModernApi: Boolean,
+        hookMethod: Executable,
+        callback: Any?,
+        kind: Int,
+        value: Long,
+    ): Boolean
+
+    /**
+     * Makes [callback] on [hookMethod] an observer, or an ordinary callback again when [receiver]
+     * is null. An observer is never called on the hooked thread: each call it accepts copies the
+     * values [captures] names, parameter indexes or -1 for the receiver, into a bounded queue, and
+     * the thread in [runObservers] passes them to `receiver.deliver(Object[])`. When the queue is
+     * full the call is dropped and counted in [observerStats].
+     *
+     * Returns false when [callback] is not registered, or [captures] names more than eight values
+     * or one the method does not have.
+     */
+    @JvmStatic
+    external fun setCallbackObserver(
+        useModernApi: Boolean,
+        hookMethod: Executable,
+        callback: Any?,
+        receiver: Any?,
+        captures: IntArray?,
+    ): Boolean
+
+    /**
+     * Delivers observer captures on the calling thread and never returns. Only one thread can be
+     * the observer thread; on any other this returns at once.
+     */
+    @JvmStatic external fun runObservers()
+
+    /** Observer captures delivered so far, then those dropped because the queue was full. */
+    @JvmStatic external fun observerStats(): LongArray
+
     /**
      * Locates a class's static initializer without initializing it.
      * [artMethods] must be the ArtMethod addresses of the class's declared constructors and
@@ -115,6 +500,51 @@ object HookBridge {
         artMethodSize: Long,
     ): Executable?
 
+    /**
+     * Every method of [clazz] as ART holds it, in the order of its method array: direct methods
+     * with the static initializer among them, declared virtual methods, then methods copied in from
+     * interfaces. Nothing is initialized.
+     *
+     * [methods] is the value of the class's `methods` field and [artMethodSize] the size of one
+     * ArtMethod. [anchors], ArtMethod addresses of members reflection shows for [clazz], are needed
+     * once per process to confirm where the array's elements start; until then this returns null.
+     */
+    @JvmStatic
+    external fun getDeclaredExecutables(
+        clazz: Class<*>,
+        methods: Long,
+        artMethodSize: Long,
+        anchors: LongArray?,
+    ): Array<Executable>?
+
+    /**
+     * Resolves members of [clazz] by name and JNI signature in one call, one element per entry of
+     * [names], null where [clazz] declares no such member. Constructors are named `<init>`.
+     * [statics] says which entries are static methods.
+     *
+     * Returns null when [clazz] is not known to be initialized, since a JNI lookup would run its
+     * static initializer; the caller then has to resolve the members through reflection.
+     */
+    @JvmStatic
+    external fun resolveMembers(
+        clazz: Class<*>,
+        names: Array<String>,
+        signatures: Array<String>,
+        statics: BooleanArray,
+    ): Array<Executable?>?
+
+    /**
+     * Loads every class in [names], binary names as for [ClassLoader.loadClass], from [loader] in
+     * one call, one element per name, null where the class is not found. A null [loader] is the
+     * boot class path, as for [Class.forName]. Classes are not initialized.
+     *
+     * Names [loader] has reported missing are remembered for as long as it lives and not asked for
+     * again, until a path is added to it or to one of its ancestors through `addDexPath`. Misses of
+     * a loader that is not a `BaseDexClassLoader` are not remembered.
+     */
+    @JvmStatic
+    external fun findClasses(loader: ClassLoader?, names: Array<String?>): Array<Class<*>?>
+
     /**
      * The class name prefixes of the legacy `de.robv` API as this process will actually be asked
      * for them, which is not the same as what they are called in source: dex obfuscation rewrites
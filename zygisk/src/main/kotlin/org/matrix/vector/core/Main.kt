@@ -11,6 +11,7 @@ import org.matrix.vector.ParasiticManagerHooker
 import org.matrix.vector.ParasiticManagerSystemHooker
 import org.matrix.vector.Startup
 import org.matrix.vector.impl.core.VectorServiceClient
+import org.matrix.vector.impl.hooks.VectorDeferredHooks
 
 /** Main entry point for the Java-side loader, invoked via JNI from the Vector Zygisk module. */
 object Main {
@@ -59,6 +60,7 @@ object Main {
 
         // Standard Xposed module loading for third-party apps
         Utils.logV("Loading Vector/Xposed for $niceName (UID: ${Process.myUid()})")
-        Startup.bootstrapXposed(isSystem && isLateInject)
+        // Hooks on classes nothing has initialized yet go in as one batch once modules are loaded.
+        VectorDeferredHooks.batch { Startup.bootstrapXposed(isSystem && isLateInject) }
     }
 }